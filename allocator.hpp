@@ -0,0 +1,280 @@
+#if !defined(ALLOCATOR)
+#define ALLOCATOR
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+struct MemoryBlock;
+
+// A range of device memory handed out by MemoryAllocator; bind resources with (memory, offset)
+struct Allocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    // Persistent host pointer to the start of this range; nullptr unless the memory is HOST_VISIBLE
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    MemoryBlock* block = nullptr;
+};
+
+// One vkAllocateMemory call, carved up into a sorted list of free/used chunks
+struct MemoryBlock {
+    struct Chunk {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        bool free;
+        // Buffers and linear images vs optimal images; neighbours of different kinds must not share a bufferImageGranularity page
+        bool linear;
+    };
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    VkDeviceSize used = 0;
+    void* mapped = nullptr;
+    bool dedicated = false;
+    std::vector<Chunk> chunks;
+};
+
+class MemoryAllocator
+{
+public:
+    struct HeapStats {
+        VkDeviceSize heapSize = 0;
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+    };
+
+    void init(VkPhysicalDevice physicalDevice, VkDevice device) {
+        this->device = device;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        bufferImageGranularity = std::max<VkDeviceSize>(deviceProperties.limits.bufferImageGranularity, 1);
+        maxMemoryAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+
+        blocks.resize(memoryProperties.memoryTypeCount);
+    }
+
+    void destroy() {
+        for (auto& typeBlocks : blocks) {
+            for (auto& block : typeBlocks) {
+                releaseBlock(*block);
+            }
+            typeBlocks.clear();
+        }
+    }
+
+    uint32_t selectMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags flags) {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) && ((memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!\n");
+    }
+
+    Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags flags, bool linear) {
+        Allocation allocation{};
+        allocation.memoryType = selectMemoryType(requirements.memoryTypeBits, flags);
+        auto& typeBlocks = blocks[allocation.memoryType];
+
+        // Large resources get a block of their own instead of fragmenting the shared ones
+        if (requirements.size > ALLOCATOR_BLOCK_SIZE / 2) {
+            MemoryBlock& block = createBlock(allocation.memoryType, requirements.size, true);
+            suballocate(block, requirements, linear, allocation);
+            return allocation;
+        }
+
+        for (auto& block : typeBlocks) {
+            if (!block->dedicated && suballocate(*block, requirements, linear, allocation)) {
+                return allocation;
+            }
+        }
+
+        // Small heaps (e.g. a 256 MiB BAR heap) should not be eaten by a handful of blocks
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[allocation.memoryType].heapIndex].size;
+        VkDeviceSize blockSize = std::max<VkDeviceSize>(std::min<VkDeviceSize>(ALLOCATOR_BLOCK_SIZE, heapSize / 8), requirements.size);
+        MemoryBlock& block = createBlock(allocation.memoryType, blockSize, false);
+        if (!suballocate(block, requirements, linear, allocation)) {
+            throw std::runtime_error("Failed to sub-allocate from a fresh memory block!\n");
+        }
+        return allocation;
+    }
+
+    void free(Allocation& allocation) {
+        if (allocation.block == nullptr) {
+            return;
+        }
+        MemoryBlock& block = *allocation.block;
+
+        auto it = std::lower_bound(block.chunks.begin(), block.chunks.end(), allocation.offset, [](const MemoryBlock::Chunk& chunk, VkDeviceSize offset) {
+            return chunk.offset + chunk.size <= offset;
+        });
+        if (it == block.chunks.end() || it->free) {
+            throw std::runtime_error("Freeing an allocation that is not owned by its block!\n");
+        }
+        it->free = true;
+        block.used -= it->size;
+
+        // coalesce with free neighbours
+        size_t i = static_cast<size_t>(it - block.chunks.begin());
+        if (i + 1 < block.chunks.size() && block.chunks[i + 1].free) {
+            block.chunks[i].size += block.chunks[i + 1].size;
+            block.chunks.erase(block.chunks.begin() + i + 1);
+        }
+        if (i > 0 && block.chunks[i - 1].free) {
+            block.chunks[i - 1].size += block.chunks[i].size;
+            block.chunks.erase(block.chunks.begin() + i);
+        }
+
+        // Keep one empty shared block per memory type around to avoid allocate/free churn
+        if (block.used == 0) {
+            auto& typeBlocks = blocks[allocation.memoryType];
+            size_t sharedBlocks = std::count_if(typeBlocks.begin(), typeBlocks.end(), [](const std::unique_ptr<MemoryBlock>& b) { return !b->dedicated; });
+            if (block.dedicated || sharedBlocks > 1) {
+                releaseBlock(block);
+                typeBlocks.erase(std::find_if(typeBlocks.begin(), typeBlocks.end(), [&](const std::unique_ptr<MemoryBlock>& b) { return b.get() == &block; }));
+            }
+        }
+
+        allocation = Allocation{};
+    }
+
+    std::vector<HeapStats> getHeapStats() const {
+        std::vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+        for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+            stats[i].heapSize = memoryProperties.memoryHeaps[i].size;
+        }
+        for (uint32_t type = 0; type < blocks.size(); type++) {
+            HeapStats& heap = stats[memoryProperties.memoryTypes[type].heapIndex];
+            for (const auto& block : blocks[type]) {
+                heap.blockCount++;
+                heap.blockBytes += block->size;
+                heap.usedBytes += block->used;
+                heap.allocationCount += static_cast<uint32_t>(std::count_if(block->chunks.begin(), block->chunks.end(), [](const MemoryBlock::Chunk& chunk) { return !chunk.free; }));
+            }
+        }
+        return stats;
+    }
+
+    void logStats() const {
+        auto stats = getHeapStats();
+        LOG("Device Memory (%u/%u vkAllocateMemory calls live):\n", deviceAllocationCount, maxMemoryAllocationCount);
+        for (size_t i = 0; i < stats.size(); i++) {
+            LOG(WHITE "\tHeap %zu: %u allocations in %u blocks, %.2f/%.2f MiB used/reserved (heap %.0f MiB)\n" CLEAR, i, stats[i].allocationCount, stats[i].blockCount, stats[i].usedBytes / 1048576.0, stats[i].blockBytes / 1048576.0, stats[i].heapSize / 1048576.0);
+        }
+    }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties{};
+    VkDeviceSize bufferImageGranularity = 1;
+    uint32_t maxMemoryAllocationCount = 0;
+    uint32_t deviceAllocationCount = 0;
+
+    // indexed by memory type; unique_ptr keeps Allocation::block stable
+    std::vector<std::vector<std::unique_ptr<MemoryBlock>>> blocks;
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    bool onSamePage(VkDeviceSize endOfFirst, VkDeviceSize startOfSecond) const {
+        return (endOfFirst - 1) / bufferImageGranularity == startOfSecond / bufferImageGranularity;
+    }
+
+    MemoryBlock& createBlock(uint32_t memoryType, VkDeviceSize size, bool dedicated) {
+        if (deviceAllocationCount >= maxMemoryAllocationCount) {
+            throw std::runtime_error("Exceeded maxMemoryAllocationCount!\n");
+        }
+
+        auto block = std::make_unique<MemoryBlock>();
+        block->size = size;
+        block->dedicated = dedicated;
+        block->chunks.push_back({0, size, true, true});
+
+        VkMemoryAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = size;
+        allocateInfo.memoryTypeIndex = memoryType;
+        vkCritical(vkAllocateMemory(device, &allocateInfo, nullptr, &block->memory));
+        deviceAllocationCount++;
+
+        if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            vkCritical(vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped));
+        }
+
+        blocks[memoryType].push_back(std::move(block));
+        return *blocks[memoryType].back();
+    }
+
+    void releaseBlock(MemoryBlock& block) {
+        if (block.mapped != nullptr) {
+            vkUnmapMemory(device, block.memory);
+        }
+        vkFreeMemory(device, block.memory, nullptr);
+        deviceAllocationCount--;
+    }
+
+    // First-fit over the free chunks of a block
+    bool suballocate(MemoryBlock& block, const VkMemoryRequirements& requirements, bool linear, Allocation& allocation) {
+        for (size_t i = 0; i < block.chunks.size(); i++) {
+            MemoryBlock::Chunk chunk = block.chunks[i];
+            if (!chunk.free || chunk.size < requirements.size) {
+                continue;
+            }
+
+            VkDeviceSize offset = alignUp(chunk.offset, std::max<VkDeviceSize>(requirements.alignment, 1));
+            if (i > 0) {
+                const auto& previous = block.chunks[i - 1];
+                if (!previous.free && previous.linear != linear && onSamePage(previous.offset + previous.size, offset)) {
+                    offset = alignUp(offset, bufferImageGranularity);
+                }
+            }
+            VkDeviceSize end = offset + requirements.size;
+            if (end > chunk.offset + chunk.size) {
+                continue;
+            }
+            if (i + 1 < block.chunks.size()) {
+                const auto& next = block.chunks[i + 1];
+                if (!next.free && next.linear != linear && onSamePage(end, next.offset)) {
+                    continue;
+                }
+            }
+
+            // split into [padding][allocation][remainder]
+            std::vector<MemoryBlock::Chunk> replacement;
+            if (offset > chunk.offset) {
+                replacement.push_back({chunk.offset, offset - chunk.offset, true, chunk.linear});
+            }
+            replacement.push_back({offset, requirements.size, false, linear});
+            if (end < chunk.offset + chunk.size) {
+                replacement.push_back({end, chunk.offset + chunk.size - end, true, chunk.linear});
+            }
+            block.chunks.erase(block.chunks.begin() + i);
+            block.chunks.insert(block.chunks.begin() + i, replacement.begin(), replacement.end());
+            block.used += requirements.size;
+
+            allocation.memory = block.memory;
+            allocation.offset = offset;
+            allocation.size = requirements.size;
+            allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+            allocation.block = &block;
+            return true;
+        }
+        return false;
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
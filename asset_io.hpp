@@ -0,0 +1,141 @@
+#if !defined(ASSET_IO)
+#define ASSET_IO
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// Read-only file mapping. Assets are consumed straight from the page cache: shader modules are created from the mapping and
+// texture levels are copied from it into staging memory, so no intermediate heap buffer is involved.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            std::swap(mapping, other.mapping);
+            std::swap(mappedSize, other.mappedSize);
+        }
+        return *this;
+    }
+
+    ~MappedFile() {
+        close();
+    }
+
+    // False if the file does not exist or cannot be mapped. `sequential` tells the kernel to read ahead aggressively and
+    // drop pages behind the reader, for files that are consumed front to back once.
+    bool open(const std::string& path, bool sequential = false) {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* address = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // The mapping keeps its own reference to the file
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        mapping = static_cast<const uint8_t*>(address);
+        mappedSize = static_cast<size_t>(status.st_size);
+        if (sequential) {
+            madvise(const_cast<uint8_t*>(mapping), mappedSize, MADV_SEQUENTIAL);
+        }
+        return true;
+    }
+
+    void close() {
+        if (mapping != nullptr) {
+            munmap(const_cast<uint8_t*>(mapping), mappedSize);
+            mapping = nullptr;
+            mappedSize = 0;
+        }
+    }
+
+    // Starts reading [offset, offset + size) into the page cache in the background, so the first access does not fault
+    void prefetch(size_t offset, size_t size) const {
+        if (mapping == nullptr || offset >= mappedSize) {
+            return;
+        }
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t begin = offset / pageSize * pageSize;
+        size_t end = std::min(offset + size, mappedSize);
+        madvise(const_cast<uint8_t*>(mapping) + begin, end - begin, MADV_WILLNEED);
+    }
+
+    bool isOpen() const { return mapping != nullptr; }
+    const uint8_t* data() const { return mapping; }
+    size_t size() const { return mappedSize; }
+
+private:
+    const uint8_t* mapping = nullptr;
+    size_t mappedSize = 0;
+};
+
+/********************************************************************************************************************************/
+// Asset I/O counters: bytes consumed from files, CPU copies made of them on the way to the GPU, and time spent loading
+struct AssetStats {
+    uint64_t filesMapped = 0;
+    uint64_t bytesRead = 0;
+    uint64_t copies = 0;
+    uint64_t bytesCopied = 0;
+    double milliseconds = 0.0;
+
+    void addFile() {
+        filesMapped++;
+    }
+
+    void addRead(size_t size) {
+        bytesRead += size;
+    }
+
+    void addCopy(size_t size) {
+        copies++;
+        bytesCopied += size;
+    }
+
+    void addTime(double loadMilliseconds) {
+        milliseconds += loadMilliseconds;
+    }
+
+    // Counters gathered on another thread
+    void merge(const AssetStats& other) {
+        filesMapped += other.filesMapped;
+        bytesRead += other.bytesRead;
+        copies += other.copies;
+        bytesCopied += other.bytesCopied;
+        milliseconds += other.milliseconds;
+    }
+
+    void report() const {
+        LOG("Assets: %llu files, %.2f MiB read, %llu copies (%.2f MiB), %.1f ms, %.2f GiB/s\n", static_cast<unsigned long long>(filesMapped),
+            bytesRead / 1048576.0, static_cast<unsigned long long>(copies), bytesCopied / 1048576.0, milliseconds,
+            milliseconds > 0.0 ? bytesRead / 1073741824.0 / (milliseconds / 1000.0) : 0.0);
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
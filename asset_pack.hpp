@@ -0,0 +1,313 @@
+#if !defined(ASSET_PACK)
+#define ASSET_PACK
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "main.hpp"
+#include "asset_io.hpp"
+
+/********************************************************************************************************************************/
+// LZ4 block format (no frame): sequences of [token][literal length...][literals][offset:2][match length...]. Decoding is a
+// tight copy loop, fast enough that a compressed entry costs less than reading its uncompressed size from a cold disk.
+namespace lz4 {
+
+const size_t MIN_MATCH = 4;
+// The format requires the last 5 bytes to be literals and the last match to start at least 12 bytes before the end
+const size_t LAST_LITERALS = 5;
+const size_t MATCH_START_LIMIT = 12;
+const uint32_t HASH_LOG = 16;
+
+inline size_t compressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+inline void writeLength(std::vector<uint8_t>& out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+inline void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+    out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15)));
+    if (literalLength >= 15) {
+        writeLength(out, literalLength - 15);
+    }
+    out.insert(out.end(), literals, literals + literalLength);
+    if (matchLength == 0) {
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (matchCode >= 15) {
+        writeLength(out, matchCode - 15);
+    }
+}
+
+// Greedy single-probe hash matcher: favors compression speed, as the packer runs on every build
+inline std::vector<uint8_t> compress(const uint8_t* src, size_t size) {
+    std::vector<uint8_t> out;
+    out.reserve(compressBound(size));
+    std::vector<int64_t> table(size_t(1) << HASH_LOG, -1);
+
+    size_t anchor = 0, position = 0;
+    if (size > MATCH_START_LIMIT) {
+        size_t matchStartLimit = size - MATCH_START_LIMIT;
+        while (position < matchStartLimit) {
+            uint32_t sequence = read32(src + position);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_LOG);
+            int64_t candidate = table[hash];
+            table[hash] = static_cast<int64_t>(position);
+            if (candidate < 0 || position - candidate > 65535 || read32(src + candidate) != sequence) {
+                position++;
+                continue;
+            }
+
+            size_t matchLength = MIN_MATCH;
+            while (position + matchLength < size - LAST_LITERALS && src[candidate + matchLength] == src[position + matchLength]) {
+                matchLength++;
+            }
+            writeSequence(out, src + anchor, position - anchor, position - candidate, matchLength);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+    writeSequence(out, src + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+// False on malformed input or if the result would not be exactly dstSize bytes
+inline bool decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* in = src;
+    const uint8_t* inEnd = src + srcSize;
+    uint8_t* out = dst;
+    uint8_t* outEnd = dst + dstSize;
+
+    auto readLength = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (in == inEnd) {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (in < inEnd) {
+        uint8_t token = *in++;
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return false;
+        }
+        if (static_cast<size_t>(inEnd - in) < literalLength || static_cast<size_t>(outEnd - out) < literalLength) {
+            return false;
+        }
+        memcpy(out, in, literalLength);
+        in += literalLength;
+        out += literalLength;
+        if (in == inEnd) {
+            // The last sequence has literals only
+            break;
+        }
+
+        if (inEnd - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MIN_MATCH;
+        if (offset == 0 || offset > static_cast<size_t>(out - dst) || static_cast<size_t>(outEnd - out) < matchLength) {
+            return false;
+        }
+        // Byte by byte: source and destination overlap when offset < matchLength
+        const uint8_t* match = out - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            out[i] = match[i];
+        }
+        out += matchLength;
+    }
+    return out == outEnd;
+}
+
+} // namespace lz4
+
+/********************************************************************************************************************************/
+// Packed asset archive (.pack): every asset of the application in one file, mapped once. Lookups go through an index of
+// name -> offset/size/type; entry data is aligned to PACK_ALIGNMENT so it can be handed to vkCreateShaderModule or copied
+// into staging memory as is.
+//
+//     PackHeader | PackEntry[entryCount] | names | entry data
+enum class AssetType : uint32_t {
+    Raw = 0,
+    Spirv = 1,
+    Texture = 2,
+};
+
+struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t namesOffset;
+    uint64_t namesSize;
+};
+
+struct PackEntry {
+    uint32_t nameOffset;
+    uint32_t nameSize;
+    AssetType type;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t uncompressedSize;
+};
+
+const uint32_t PACK_MAGIC = 0x4b50564c; // "LVPK"
+const uint32_t PACK_VERSION = 1;
+const uint32_t PACK_ENTRY_LZ4 = 1;
+const uint64_t PACK_ALIGNMENT = 256;
+// LZ4 expands by at most this factor (every sequence a minimal match), so an entry claiming more is corrupt
+const uint64_t PACK_LZ4_MAX_RATIO = 255;
+
+inline AssetType assetTypeFromPath(const std::string& path) {
+    auto endsWith = [&](const char* suffix) {
+        size_t length = strlen(suffix);
+        return path.size() >= length && path.compare(path.size() - length, length, suffix) == 0;
+    };
+    return endsWith(".spv") ? AssetType::Spirv : endsWith(".lvtex") ? AssetType::Texture : AssetType::Raw;
+}
+
+// The bytes of one asset: either inside a mapping (a pack or a loose file) or decompressed into `storage`
+struct Asset {
+    MappedFile file;
+    std::vector<uint8_t> storage;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+class AssetPack
+{
+public:
+    // False if there is no valid pack at `path`; assets are then loaded from loose files
+    bool open(const std::string& path) {
+        if (!file.open(path)) {
+            return false;
+        }
+
+        PackHeader header{};
+        if (file.size() < sizeof(header)) {
+            file.close();
+            return false;
+        }
+        memcpy(&header, file.data(), sizeof(header));
+        size_t indexEnd = sizeof(header) + static_cast<size_t>(header.entryCount) * sizeof(PackEntry);
+        // Ranges are checked as offset <= limit and size <= limit - offset, so corrupt values cannot wrap around
+        if (header.magic != PACK_MAGIC || header.version != PACK_VERSION || indexEnd > file.size()
+            || header.namesOffset > file.size() || header.namesSize > file.size() - header.namesOffset) {
+            LOG("Asset Pack: %s is not a valid pack, ignoring\n", path.c_str());
+            file.close();
+            return false;
+        }
+
+        entries.resize(header.entryCount);
+        memcpy(entries.data(), file.data() + sizeof(header), header.entryCount * sizeof(PackEntry));
+        const char* names = reinterpret_cast<const char*>(file.data() + header.namesOffset);
+        for (const PackEntry& entry : entries) {
+            bool compressed = (entry.flags & PACK_ENTRY_LZ4) != 0;
+            if (entry.nameOffset > header.namesSize || entry.nameSize > header.namesSize - entry.nameOffset
+                || entry.offset > file.size() || entry.size > file.size() - entry.offset
+                || (compressed && entry.uncompressedSize > entry.size * PACK_LZ4_MAX_RATIO)) {
+                LOG("Asset Pack: %s has a corrupt index, ignoring\n", path.c_str());
+                entries.clear();
+                index.clear();
+                file.close();
+                return false;
+            }
+            index.emplace(std::string(names + entry.nameOffset, entry.nameSize), &entry - entries.data());
+        }
+        return true;
+    }
+
+    void close() {
+        entries.clear();
+        index.clear();
+        file.close();
+    }
+
+    bool isOpen() const {
+        return file.isOpen();
+    }
+
+    size_t getEntryCount() const {
+        return entries.size();
+    }
+
+    size_t getSize() const {
+        return file.size();
+    }
+
+    // Starts reading an entry into the page cache in the background; false if the pack has no such entry
+    bool prefetch(const std::string& name) const {
+        const PackEntry* entry = find(name);
+        if (entry == nullptr) {
+            return false;
+        }
+        file.prefetch(static_cast<size_t>(entry->offset), static_cast<size_t>(entry->size));
+        return true;
+    }
+
+    // Stored entries point into the pack mapping, which outlives them; compressed ones are decoded into asset.storage
+    bool load(const std::string& name, Asset& asset, AssetStats& stats) const {
+        const PackEntry* entry = find(name);
+        if (entry == nullptr) {
+            return false;
+        }
+        const uint8_t* data = file.data() + entry->offset;
+        stats.addRead(static_cast<size_t>(entry->size));
+        if ((entry->flags & PACK_ENTRY_LZ4) == 0) {
+            asset.data = data;
+            asset.size = static_cast<size_t>(entry->size);
+            return true;
+        }
+
+        asset.storage.resize(static_cast<size_t>(entry->uncompressedSize));
+        if (!lz4::decompress(data, static_cast<size_t>(entry->size), asset.storage.data(), asset.storage.size())) {
+            throw std::runtime_error("Asset Pack: corrupt entry " + name);
+        }
+        stats.addCopy(asset.storage.size());
+        asset.data = asset.storage.data();
+        asset.size = asset.storage.size();
+        return true;
+    }
+
+private:
+    MappedFile file;
+    std::vector<PackEntry> entries;
+    std::unordered_map<std::string, size_t> index;
+
+    const PackEntry* find(const std::string& name) const {
+        auto it = index.find(name);
+        return it == index.end() ? nullptr : &entries[it->second];
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
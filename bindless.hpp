@@ -0,0 +1,243 @@
+#if !defined(BINDLESS)
+#define BINDLESS
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "main.hpp"
+#include "allocator.hpp"
+
+/********************************************************************************************************************************/
+// Bindless resources (descriptor indexing, core in 1.2 or VK_EXT_descriptor_indexing): one descriptor set, bound once per
+// command buffer, holding
+//
+//     binding 0: sampled images, an update-after-bind array of up to BINDLESS_MAX_TEXTURES, partially bound
+//     binding 1: the sampler all of them are read with
+//     binding 2: the material table, a storage buffer with a region of BINDLESS_MAX_MATERIALS per frame in flight
+//
+// Draws select their material with a push constant and materials select their texture by index, so the number of textures
+// a frame can reference does not depend on how many sets are allocated or bound. Texture slots are written while frames
+// that do not sample them are in flight; a slot is only handed out again once removeTexture() says nothing reads it.
+
+// std430 layout, must match shaders/bindless.fs
+struct BindlessMaterial {
+    glm::vec4 tint;
+    uint32_t textureIndex;
+    uint32_t padding[3];
+};
+
+class BindlessTable
+{
+public:
+    void init(VkDevice device, MemoryAllocator* allocator, uint32_t textureCapacity) {
+        this->device = device;
+        this->allocator = allocator;
+        this->textureCapacity = textureCapacity;
+
+        std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        bindings[0].descriptorCount = textureCapacity;
+        bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        bindings[1].descriptorCount = 1;
+        bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[2].binding = 2;
+        bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[2].descriptorCount = 1;
+        bindings[2].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+        // Unused slots may hold nothing (or views that are gone); written slots may change while the set is bound
+        std::array<VkDescriptorBindingFlags, 3> bindingFlags = {
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT,
+            0,
+            0,
+        };
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo{};
+        bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+        layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutCreateInfo.pBindings = bindings.data();
+        vkCritical(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &layout));
+
+        std::array<VkDescriptorPoolSize, 3> poolSizes{};
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        poolSizes[0].descriptorCount = textureCapacity;
+        poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+        poolSizes[1].descriptorCount = 1;
+        poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSizes[2].descriptorCount = 1;
+
+        VkDescriptorPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolCreateInfo.pPoolSizes = poolSizes.data();
+        poolCreateInfo.maxSets = 1;
+        vkCritical(vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &pool));
+
+        VkDescriptorSetAllocateInfo allocateInfo{};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocateInfo.descriptorPool = pool;
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &layout;
+        vkCritical(vkAllocateDescriptorSets(device, &allocateInfo, &set));
+
+        // Persistently mapped; the region of a frame in flight is only rewritten once that frame has completed
+        VkBufferCreateInfo bufferCreateInfo{};
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferCreateInfo.size = sizeof(BindlessMaterial) * BINDLESS_MAX_MATERIALS * MAX_FRAMES_IN_FLIGHT;
+        bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        vkCritical(vkCreateBuffer(device, &bufferCreateInfo, nullptr, &materialBuffer));
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(device, materialBuffer, &memoryRequirements);
+        memoryMaterialBuffer = allocator->allocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+        vkCritical(vkBindBufferMemory(device, materialBuffer, memoryMaterialBuffer.memory, memoryMaterialBuffer.offset));
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = materialBuffer;
+        bufferInfo.offset = 0;
+        bufferInfo.range = VK_WHOLE_SIZE;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 2;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    void destroy() {
+        vkDestroyBuffer(device, materialBuffer, nullptr);
+        allocator->free(memoryMaterialBuffer);
+        vkDestroyDescriptorPool(device, pool, nullptr);
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+
+    VkDescriptorSetLayout getLayout() const { return layout; }
+    VkDescriptorSet getSet() const { return set; }
+    uint32_t getTextureCapacity() const { return textureCapacity; }
+    uint32_t getTextureCount() const { return textureCount - static_cast<uint32_t>(freeTextures.size()); }
+
+    // Before the set is first bound
+    void setSampler(VkSampler sampler) {
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 1;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+
+    // Writes the view into a free slot and returns its index; the view has to be in SHADER_READ_ONLY_OPTIMAL when sampled
+    uint32_t addTexture(VkImageView imageView) {
+        uint32_t index;
+        if (!freeTextures.empty()) {
+            index = freeTextures.back();
+            freeTextures.pop_back();
+        } else if (textureCount < textureCapacity) {
+            index = textureCount++;
+        } else {
+            throw std::runtime_error("Bindless texture array is full\n");
+        }
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = imageView;
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.dstBinding = 0;
+        write.dstArrayElement = index;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        return index;
+    }
+
+    // Only once no submitted frame can sample the slot any more (see DeletionQueue)
+    void removeTexture(uint32_t index) {
+        freeTextures.push_back(index);
+    }
+
+    uint32_t addMaterial(const BindlessMaterial& material) {
+        if (materials.size() == BINDLESS_MAX_MATERIALS) {
+            throw std::runtime_error("Bindless material table is full\n");
+        }
+        materials.push_back(material);
+        materialVersion++;
+        return static_cast<uint32_t>(materials.size() - 1);
+    }
+
+    // Points every material sampling texture `from` at texture `to`; frames already submitted keep reading their own copy
+    void replaceTexture(uint32_t from, uint32_t to) {
+        for (auto& material : materials) {
+            if (material.textureIndex == from) {
+                material.textureIndex = to;
+            }
+        }
+        materialVersion++;
+    }
+
+    // Copies the material table into the region of `frame` if that region is out of date; call once waitForFrameSlot() has returned
+    void updateMaterials(size_t frame) {
+        if (regionVersions[frame] == materialVersion) {
+            return;
+        }
+        memcpy(static_cast<uint8_t*>(memoryMaterialBuffer.mapped) + frame * BINDLESS_MAX_MATERIALS * sizeof(BindlessMaterial), materials.data(),
+            materials.size() * sizeof(BindlessMaterial));
+        regionVersions[frame] = materialVersion;
+    }
+
+    // Index of the first material of the region of `frame`, added to the per-draw material index in the push constant
+    uint32_t getMaterialBase(size_t frame) const {
+        return static_cast<uint32_t>(frame * BINDLESS_MAX_MATERIALS);
+    }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    VkDescriptorPool pool = VK_NULL_HANDLE;
+    VkDescriptorSet set = VK_NULL_HANDLE;
+
+    uint32_t textureCapacity = 0;
+    // Slots [0, textureCount) have been handed out at least once; freeTextures are the ones returned since
+    uint32_t textureCount = 0;
+    std::vector<uint32_t> freeTextures;
+
+    VkBuffer materialBuffer = VK_NULL_HANDLE;
+    Allocation memoryMaterialBuffer;
+    std::vector<BindlessMaterial> materials;
+    // Starts at 1 so that every region is written before its first use
+    uint64_t materialVersion = 1;
+    uint64_t regionVersions[MAX_FRAMES_IN_FLIGHT] = {};
+};
+/********************************************************************************************************************************/
+
+#endif
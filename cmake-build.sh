@@ -11,14 +11,33 @@ printf "${BRIGHT_RED}Compiling vertex shader......\n${CLEAR}"
 glslc -fshader-stage=vertex ../shaders/main.vs -o vertex.spv
 printf "${BRIGHT_RED}Vertex shader is compiled, 'vertex.spv' is generated\n${CLEAR}"
 
+printf "${BRIGHT_RED}Compiling instanced vertex shader......\n${CLEAR}"
+glslc -fshader-stage=vertex ../shaders/instanced.vs -o instanced.spv
+printf "${BRIGHT_RED}Instanced vertex shader is compiled, 'instanced.spv' is generated\n${CLEAR}"
+
 printf "${BRIGHT_RED}Compiling fragment shader......\n\x1b[0m"
 glslc -fshader-stage=fragment ../shaders/main.fs -o fragment.spv
 printf "${BRIGHT_RED}Fragment shader is compiled, 'fragment.spv' is generated\n${CLEAR}"
 
+printf "${BRIGHT_RED}Compiling bindless fragment shader......\n${CLEAR}"
+glslc -fshader-stage=fragment ../shaders/bindless.fs -o bindless.spv
+printf "${BRIGHT_RED}Bindless fragment shader is compiled, 'bindless.spv' is generated\n${CLEAR}"
+
+printf "${BRIGHT_RED}Compiling culling compute shader......\n${CLEAR}"
+glslc -fshader-stage=compute ../shaders/cull.comp -o cull.spv
+printf "${BRIGHT_RED}Culling compute shader is compiled, 'cull.spv' is generated\n${CLEAR}"
+
 printf "${BRIGHT_RED}Running cmake......\n${CLEAR}"
 cmake ../.
 
 printf "${BRIGHT_RED}Running make......\n${CLEAR}"
 make
 
-cd ..
\ No newline at end of file
+printf "${BRIGHT_RED}Cooking textures......\n${CLEAR}"
+../cook.app ../textures/texture.jpg ../textures/texture.lvtex
+
+cd ..
+
+# Entries are named by their path relative to the project root, which is what the application looks them up by
+printf "${BRIGHT_RED}Packing assets......\n${CLEAR}"
+./pack.app build/assets.pack --lz4 build/vertex.spv build/instanced.spv build/fragment.spv build/bindless.spv build/cull.spv textures/texture.lvtex
\ No newline at end of file
@@ -0,0 +1,87 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <chrono>
+#include <string>
+
+#include "main.hpp"
+#include "mipmaps.hpp"
+#include "texture_format.hpp"
+
+/********************************************************************************************************************************/
+// Offline texture cooker: decodes an image once, builds its mip chain and writes it block-compressed as .lvtex, so the
+// application never decodes JPEG/PNG at startup.
+//
+//     cook.app <input image> <output.lvtex> [--bc1|--bc3|--rgba8] [--linear]
+//
+// Without a format option, images with any translucent texel are stored as BC3 and all others as BC1.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <input image> <output.lvtex> [--bc1|--bc3|--rgba8] [--linear]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string inputPath = argv[1], outputPath = argv[2];
+
+    bool formatForced = false, srgb = true;
+    TextureFormat format = TextureFormat::BC1;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bc1" || arg == "--bc3" || arg == "--rgba8") {
+            format = arg == "--bc1" ? TextureFormat::BC1 : arg == "--bc3" ? TextureFormat::BC3 : TextureFormat::RGBA8;
+            formatForced = true;
+        } else if (arg == "--linear") {
+            srgb = false;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg.c_str());
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int imageWidth, imageHeight, imageChannels;
+    stbi_uc* pixels = stbi_load(inputPath.c_str(), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+    if (!pixels) {
+        fprintf(stderr, "Failed to load %s: %s\n", inputPath.c_str(), stbi_failure_reason());
+        return EXIT_FAILURE;
+    }
+    uint32_t width = static_cast<uint32_t>(imageWidth), height = static_cast<uint32_t>(imageHeight);
+
+    if (!formatForced) {
+        for (size_t i = 3; i < static_cast<size_t>(width) * height * 4; i += 4) {
+            if (pixels[i] != 255) {
+                format = TextureFormat::BC3;
+                break;
+            }
+        }
+    }
+
+    CookedTexture texture;
+    texture.format = format;
+    texture.srgb = srgb;
+    texture.chain = buildMipChain(pixels, width, height, srgb);
+    stbi_image_free(pixels);
+
+    size_t uncompressedSize = texture.chain.data.size();
+    if (format != TextureFormat::RGBA8) {
+        texture.chain = compressMipChain(texture.chain, format);
+    }
+
+    if (!writeCookedTexture(outputPath, texture)) {
+        fprintf(stderr, "Failed to write %s\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    LOG("Cooked %s -> %s: %u x %u, %zu mip levels, %s%s, %.1f KiB (%.1fx smaller than RGBA8) in %.1f ms\n", inputPath.c_str(), outputPath.c_str(),
+        width, height, texture.chain.levels.size(), textureFormatName(format), srgb ? " sRGB" : "", texture.chain.data.size() / 1024.0,
+        static_cast<double>(uncompressedSize) / texture.chain.data.size(),
+        std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+    return EXIT_SUCCESS;
+}
+/********************************************************************************************************************************/
@@ -0,0 +1,57 @@
+#if !defined(DELETION_QUEUE)
+#define DELETION_QUEUE
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// Deferred destruction: objects replaced while frames are in flight are pushed with the timeline value of the last submission
+// that may use them, and destroyed by collect() once the timeline has reached that value. Nothing waits for the GPU; a
+// resize or a streamed texture level just leaves its old objects here for a frame or two.
+class DeletionQueue
+{
+public:
+    void push(uint64_t value, std::function<void()> destroy) {
+        entries.push_back({value, std::move(destroy)});
+    }
+
+    // Runs the callbacks of every completed value, in the order they were pushed, and compacts the rest in place
+    void collect(uint64_t completedValue) {
+        auto kept = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->value <= completedValue) {
+                it->destroy();
+            } else {
+                if (kept != it) {
+                    *kept = std::move(*it);
+                }
+                ++kept;
+            }
+        }
+        entries.erase(kept, entries.end());
+    }
+
+    // Runs every callback; only once the device is idle
+    void flush() {
+        for (auto& entry : entries) {
+            entry.destroy();
+        }
+        entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+
+private:
+    struct Entry {
+        uint64_t value;
+        std::function<void()> destroy;
+    };
+    std::deque<Entry> entries;
+};
+/********************************************************************************************************************************/
+
+#endif
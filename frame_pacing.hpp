@@ -0,0 +1,116 @@
+#if !defined(FRAME_PACING)
+#define FRAME_PACING
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// Frame pacing: how many frames the CPU may run ahead of the GPU, which present mode the swapchain asks for and whether the
+// CPU holds frames back to a rate.
+//
+//     latency:     1 frame in flight, IMMEDIATE (or FIFO_RELAXED), minimum swapchain images; input is sampled as late as possible
+//     throughput:  N frames in flight (--frames-in-flight), MAILBOX where available
+//     power:       FIFO (vsync) and a CPU frame limit, so neither the CPU nor the GPU renders frames nobody sees
+enum class PacingMode {
+    Latency,
+    Throughput,
+    PowerSaving,
+};
+
+inline const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+    case PacingMode::Latency:
+        return "latency";
+    case PacingMode::PowerSaving:
+        return "power";
+    default:
+        return "throughput";
+    }
+}
+
+inline const char* presentModeName(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR:
+        return "IMMEDIATE";
+    case VK_PRESENT_MODE_MAILBOX_KHR:
+        return "MAILBOX";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+        return "FIFO_RELAXED";
+    default:
+        return "FIFO";
+    }
+}
+
+// `requested` is the --frames-in-flight value, 0 if not given; only the throughput mode honors it
+inline uint32_t pacingFramesInFlight(PacingMode mode, uint32_t requested) {
+    if (mode == PacingMode::Latency) {
+        return 1;
+    }
+    if (mode == PacingMode::Throughput && requested > 0) {
+        return std::min<uint32_t>(requested, MAX_FRAMES_IN_FLIGHT);
+    }
+    return DEFAULT_FRAMES_IN_FLIGHT;
+}
+
+// The first of the mode's preferences the surface supports; FIFO is always supported
+inline VkPresentModeKHR selectPacingPresentMode(PacingMode mode, const std::vector<VkPresentModeKHR>& availablePresentModes) {
+    std::vector<VkPresentModeKHR> preferences;
+    switch (mode) {
+    case PacingMode::Latency:
+        preferences = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+        break;
+    case PacingMode::Throughput:
+        preferences = {VK_PRESENT_MODE_MAILBOX_KHR};
+        break;
+    default:
+        break;
+    }
+    for (auto preference : preferences) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preference) != availablePresentModes.end()) {
+            return preference;
+        }
+    }
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+// Holds the CPU to at most maxFps frames per second. Frames are scheduled on a fixed grid, so the rate does not drift with
+// the sleep granularity; a frame that misses its slot by more than a period restarts the grid instead of bursting to catch up.
+class FrameLimiter
+{
+public:
+    void setMaxFps(float maxFps) {
+        period = maxFps > 0.0f ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxFps)) : Clock::duration::zero();
+        nextFrame = Clock::time_point();
+    }
+
+    bool isEnabled() const {
+        return period > Clock::duration::zero();
+    }
+
+    void wait() {
+        if (!isEnabled()) {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        if (nextFrame == Clock::time_point() || now > nextFrame + period) {
+            nextFrame = now;
+        } else if (now < nextFrame) {
+            std::this_thread::sleep_until(nextFrame);
+        }
+        nextFrame += period;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    Clock::duration period = Clock::duration::zero();
+    Clock::time_point nextFrame;
+};
+/********************************************************************************************************************************/
+
+#endif
@@ -0,0 +1,178 @@
+#if !defined(JOBS)
+#define JOBS
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// Fixed pool of worker threads for fork/join style work. Worker indices are stable, so callers can keep per-worker state
+// (e.g. a VkCommandPool) indexed by them; the thread calling dispatch() always takes part as worker 0.
+class JobSystem
+{
+public:
+    using Job = std::function<void(uint32_t job, uint32_t worker)>;
+
+    void init(uint32_t workerCount) {
+        this->workerCount = std::max(workerCount, 1u);
+        for (uint32_t i = 1; i < this->workerCount; i++) {
+            threads.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    void destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        threads.clear();
+    }
+
+    uint32_t getWorkerCount() const {
+        return workerCount;
+    }
+
+    // Runs job(0 .. jobCount-1) spread over all workers and returns once every job has finished
+    void dispatch(uint32_t jobCount, const Job& job) {
+        if (jobCount == 0) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // A worker that woke up late for the previous dispatch must be out before the job state is replaced
+            idle.wait(lock, [&] { return activeWorkers == 0; });
+            current = &job;
+            this->jobCount = jobCount;
+            nextJob = 0;
+            generation++;
+        }
+        wake.notify_all();
+
+        runJobs(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [&] { return activeWorkers == 0; });
+    }
+
+private:
+    uint32_t workerCount = 1;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool stopping = false;
+    uint64_t generation = 0;
+    uint32_t activeWorkers = 0;
+
+    // Only replaced while no worker is active
+    const Job* current = nullptr;
+    uint32_t jobCount = 0;
+    std::atomic<uint32_t> nextJob{0};
+
+    void runJobs(uint32_t worker) {
+        for (uint32_t index = nextJob.fetch_add(1); index < jobCount; index = nextJob.fetch_add(1)) {
+            (*current)(index, worker);
+        }
+    }
+
+    void workerLoop(uint32_t worker) {
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) {
+                    return;
+                }
+                seenGeneration = generation;
+                activeWorkers++;
+            }
+
+            runJobs(worker);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                activeWorkers--;
+            }
+            idle.notify_all();
+        }
+    }
+};
+/********************************************************************************************************************************/
+// Background threads for long-running work whose results are picked up later, e.g. decoding assets while frames are being
+// rendered. Separate from JobSystem so a slow task never holds up a frame's fork/join dispatch.
+class TaskQueue
+{
+public:
+    using Task = std::function<void()>;
+
+    void init(uint32_t threadCount) {
+        for (uint32_t i = 0; i < std::max(threadCount, 1u); i++) {
+            threads.emplace_back(&TaskQueue::workerLoop, this);
+        }
+    }
+
+    // Tasks not started yet are dropped; running ones are waited for
+    void destroy() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            tasks.clear();
+        }
+        wake.notify_all();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        threads.clear();
+    }
+
+    uint32_t getThreadCount() const {
+        return static_cast<uint32_t>(threads.size());
+    }
+
+    void push(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+        }
+        wake.notify_one();
+    }
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> tasks;
+    bool stopping = false;
+
+    void workerLoop() {
+        for (;;) {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || !tasks.empty(); });
+                if (stopping) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
@@ -15,6 +15,7 @@
 // C
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 // C++
 #include <iostream>
@@ -24,38 +25,85 @@
 #include <optional>
 #include <string>
 #include <limits>
+#include <cmath>
 #include <chrono>
 
 #include <algorithm>
 #include <vector>
 #include <array>
 #include <set>
+#include <deque>
 
 #include "main.hpp"
+#include "allocator.hpp"
+#include "timeline.hpp"
+#include "transfer.hpp"
+#include "profiler.hpp"
+#include "transform_batch.hpp"
+#include "mesh.hpp"
+#include "vertex_layout.hpp"
+#include "pipeline_cache.hpp"
+#include "jobs.hpp"
+#include "mipmaps.hpp"
+#include "texture_format.hpp"
+#include "asset_io.hpp"
+#include "asset_pack.hpp"
+#include "frame_pacing.hpp"
+#include "deletion_queue.hpp"
+#include "bindless.hpp"
 
 /********************************************************************************************************************************/
-#define vkCritical(result) if (result != VK_SUCCESS) { throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": Vulkan Failure\n"); }
-
-#if defined(ENABLE_LOGGING)
-#define LOG(...) printf(BRIGHT_RED); printf(__VA_ARGS__); printf(CLEAR);
-#else
-#define LOG(...)
-#endif
-
-#if defined(ENABLE_DEBUG_LOGGING)
-#define DLOG(...) printf(RED); printf(__VA_ARGS__); printf(CLEAR);
-#else
-#define DLOG(...)
-#endif
+struct AppOptions {
+    // Render into renderer-owned images instead of a GLFW window + swapchain (no presentation, no vsync)
+    bool headless = false;
+    // Number of frames to render before exiting; 0 means until the window is closed
+    uint64_t frameCount = 0;
+    // Number of objects in the scene, each drawn with its own draw call and push constants unless instanced
+    uint32_t objectCount = 1;
+    // Worker threads recording secondary command buffers; 0 records everything inline into the primary
+    uint32_t recordThreads = 0;
+    // Simulated seconds per frame; 0 animates by the wall clock
+    float fixedTimestep = 0.0f;
+    // Headless frames rendered before measuring starts
+    uint64_t warmupFrames = 0;
+    // Write a JSON report after a headless run; "-" writes it to stdout
+    std::string reportPath;
+    // Wavefront OBJ drawn for every object instead of the built-in quad
+    std::string meshPath;
+    // Vertex buffer layout: full float attributes, or 16-byte quantized vertices with half or SNORM16 positions
+    VertexFormat vertexFormat = VertexFormat::Snorm16;
+    // Upload the coarse mip levels first and refine the texture while rendering
+    bool streamTextures = false;
+    // Draw all objects with one instanced call, their transforms in a per-instance vertex buffer
+    bool instanced = false;
+    // Animate, frustum-cull and emit the draws of all objects in a compute pass (implies --instanced)
+    bool gpuCulling = false;
+    // Sample textures from one update-after-bind descriptor array and pick materials per draw by index (see bindless.hpp)
+    bool bindless = false;
+    // Frames in flight, present mode and frame limit (see frame_pacing.hpp)
+    PacingMode pacing = PacingMode::Throughput;
+    // Frames in flight of the throughput mode; 0 uses DEFAULT_FRAMES_IN_FLIGHT
+    uint32_t framesInFlight = 0;
+    // CPU frame limit; 0 is unlimited, except in the power saving mode
+    float maxFps = 0.0f;
+    // Threads decoding textures in the background
+    uint32_t decodeThreads = std::max(1u, std::thread::hardware_concurrency() / 2);
+};
 /********************************************************************************************************************************/
 
 /********************************************************************************************************************************/
 class HelloVulkan
 {
 public:
+    explicit HelloVulkan(const AppOptions& options) : options(options), framesInFlight(pacingFramesInFlight(options.pacing, options.framesInFlight)) {}
+
     void run() {
-        setupWindow();
+        startTime = std::chrono::high_resolution_clock::now();
+        if (!options.headless) {
+            setupWindow();
+        }
         setupVulkan();
+        assetStats.report();
         mainLoop();
         // printf(RED "Here: %u\n" CLEAR, __LINE__);
         cleanup();
@@ -63,9 +111,14 @@ public:
     }
 
 private:
+    const AppOptions options;
+    // Frame slots cycled through, at most MAX_FRAMES_IN_FLIGHT
+    const uint32_t framesInFlight;
+    std::chrono::high_resolution_clock::time_point startTime;
+
     const uint32_t WIDTH = 1024;
     const uint32_t HEIGHT = 768;
-    GLFWwindow* window;
+    GLFWwindow* window = nullptr;
 
     void setupWindow() {
         glfwInit();
@@ -88,20 +141,35 @@ private:
     VkInstance instance;
     VkDebugUtilsMessengerEXT debugMessenger;
     
-    VkSurfaceKHR surface;
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
 
-    VkPhysicalDevice physicalDevice;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceFeatures supportedFeatures{};
     VkDevice device;
 
+    MemoryAllocator allocator;
+    TransferScheduler transfer;
+    GpuProfiler profiler;
+    PipelineCache pipelineCache;
+
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> surfaceFamily;
+        // A transfer-only family when the hardware has one (DMA engine), the graphics family otherwise
+        std::optional<uint32_t> transferFamily;
+        // Headless rendering has no surface, hence no presentation queue to look for
+        bool presentRequired = true;
 
         bool isComplete() {
-            return graphicsFamily.has_value() && surfaceFamily.has_value();
+            return graphicsFamily.has_value() && (surfaceFamily.has_value() || !presentRequired);
         }
 
         void getQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface) {
+            graphicsFamily.reset();
+            surfaceFamily.reset();
+            transferFamily.reset();
+            presentRequired = (surface != VK_NULL_HANDLE);
+
             uint32_t queueFamilyCount = 0;
             vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
             std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
@@ -114,7 +182,7 @@ private:
                     this->graphicsFamily = i;
                 }
 
-                if (!this->surfaceFamily.has_value()) {
+                if (this->presentRequired && !this->surfaceFamily.has_value()) {
                     VkBool32 surfaceSupport = false; // aka presentSupport
                     vkCritical(vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &surfaceSupport));
                     if (surfaceSupport) {
@@ -127,6 +195,24 @@ private:
                 }
                 i++;
             }
+
+            // Prefer a family without graphics and compute, then one without graphics
+            for (int pass = 0; pass < 2 && !this->transferFamily.has_value(); pass++) {
+                VkQueueFlags excluded = pass == 0 ? (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) : VK_QUEUE_GRAPHICS_BIT;
+                for (uint32_t j = 0; j < queueFamilies.size(); j++) {
+                    if ((queueFamilies[j].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamilies[j].queueFlags & excluded)) {
+                        this->transferFamily = j;
+                        break;
+                    }
+                }
+            }
+            if (!this->transferFamily.has_value()) {
+                this->transferFamily = this->graphicsFamily;
+            }
+        }
+
+        bool hasDedicatedTransfer() {
+            return transferFamily != graphicsFamily;
         }
     };
 
@@ -165,13 +251,16 @@ private:
     QueueFamilyIndices queueFamilyIndices;
     VkQueue graphicsQueue;
     VkQueue presentQueue;
+    VkQueue transferQueue;
 
     SwapchainDetails swapchainDetails;
-    VkSwapchainKHR swapchain;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
     std::vector<VkImage> swapchainImages;
     VkFormat swapchainImageFormat;
     VkExtent2D swapchainImageExtent;
     std::vector<VkImageView> swapchainImageViews;
+    // In headless mode swapchainImages are owned by the renderer and backed by these allocations
+    std::vector<Allocation> memoryOffscreenImages;
 
     VkRenderPass renderPass;
     VkDescriptorSetLayout descriptorSetLayout;
@@ -179,112 +268,301 @@ private:
     VkPipeline graphicsPipeline;
     std::vector<VkFramebuffer> swapchainFramebuffers;
     
-    #define VertexAttributeCount 3
-    struct Vertex {
-        glm::vec2 vertexPosition;
-        glm::vec3 vertexColor;
-        glm::vec2 texturePosition;
+    // Per-instance attributes of the instanced path (binding 1): the model matrix, one column per location 3-6, and the object
+    // it belongs to at location 7. Must match the Instance struct of shaders/cull.comp.
+    struct InstanceData {
+        glm::mat4 model;
+        uint32_t object;
+        uint32_t padding[3];
 
         static VkVertexInputBindingDescription getBindingDescription() {
             VkVertexInputBindingDescription bindingDescription;
-            bindingDescription.binding = 0;
-            bindingDescription.stride = sizeof(Vertex);
-            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-            // ToDo: copy return
+            bindingDescription.binding = 1;
+            bindingDescription.stride = sizeof(InstanceData);
+            bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
             return bindingDescription;
         }
 
-        static std::array<VkVertexInputAttributeDescription, VertexAttributeCount> getAttributeDescriptions() {
-            std::array<VkVertexInputAttributeDescription, VertexAttributeCount> attributeDescriptions;
-            attributeDescriptions[0].binding = 0;
-            attributeDescriptions[0].location = 0;
-            attributeDescriptions[0].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[0].offset = offsetof(Vertex, vertexPosition);
-
-            attributeDescriptions[1].binding = 0;
-            attributeDescriptions[1].location = 1;
-            attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attributeDescriptions[1].offset = offsetof(Vertex, vertexColor);
-
-            attributeDescriptions[2].binding = 0;
-            attributeDescriptions[2].location = 2;
-            attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-            attributeDescriptions[2].offset = offsetof(Vertex, texturePosition);
-
-            // ToDo: copy return
+        static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions() {
+            std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions;
+            for (uint32_t column = 0; column < 4; column++) {
+                attributeDescriptions[column].binding = 1;
+                attributeDescriptions[column].location = 3 + column;
+                attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attributeDescriptions[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+            }
+            attributeDescriptions[4].binding = 1;
+            attributeDescriptions[4].location = 7;
+            attributeDescriptions[4].format = VK_FORMAT_R32_UINT;
+            attributeDescriptions[4].offset = offsetof(InstanceData, object);
             return attributeDescriptions;
         }
     };
-    const std::vector<Vertex> vertices = {
-        {{-0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
-        {{0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
-        {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
-        {{-0.5f, 0.5f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
-    };
 
-    using Index_t = uint16_t;
-    const VkIndexType VK_INDEX_TYPE = VK_INDEX_TYPE_UINT16;
-    const std::vector<Index_t> indices = {2, 1, 0, 0, 3, 2};
+    // Filled by loadMesh(): vertices packed in the layout of vertexFormat (see vertex_layout.hpp), indices 16 bit whenever the
+    // vertex count allows it
+    VertexFormat vertexFormat = VertexFormat::Float;
+    uint32_t vertexStride = 0;
+    std::array<VkVertexInputAttributeDescription, VERTEX_ATTRIBUTE_COUNT> vertexAttributeDescriptions;
+    std::vector<uint8_t> vertexData;
+    size_t vertexCount = 0;
+    float meshBoundingRadius = 0.0f;
+    std::vector<uint8_t> indexData;
+    uint32_t indexCount = 0;
+    VkIndexType indexType = VK_INDEX_TYPE_UINT16;
     
     VkBuffer vertexBuffer;
-    VkDeviceMemory memoryVertexBuffer;
+    Allocation memoryVertexBuffer;
     VkBuffer indexBuffer;
-    VkDeviceMemory memoryIndexBuffer;
+    Allocation memoryIndexBuffer;
 
-    struct UniformBufferObject {
-        alignas(16) glm::mat4 model;
+    // Shared by every draw of a frame; must match shaders/main.vs and shaders/instanced.vs
+    struct CameraUniforms {
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 projection;
     };
 
-    std::vector<VkBuffer> uniformBuffers;
-    std::vector<VkDeviceMemory> memoryUniformBuffers;
+    // Pushed before every draw, so per-object state needs neither buffer writes nor descriptor binds. Must match
+    // shaders/main.vs and shaders/instanced.vs.
+    struct DrawConstants {
+        glm::mat4 model;
+        uint32_t objectIndex;
+        // Bindless path: the first material of the frame's region; the vertex shader adds the object's palette entry
+        uint32_t materialIndex;
+    };
+    // The push constant space every implementation provides
+    static_assert(sizeof(DrawConstants) <= 128, "draw constants exceed the guaranteed push constant size");
+
+    // One persistently mapped ring with a camera slot per frame in flight
+    VkBuffer uniformBuffer;
+    Allocation memoryUniformBuffer;
+    VkDeviceSize uniformSlotSize;
+
+    // Camera state is only rebuilt when it changes; each ring slot remembers which version it holds
+    glm::mat4 cameraView;
+    glm::mat4 cameraProjection;
+    uint64_t cameraVersion = 0;
+    uint64_t uniformRegionCameraVersion[MAX_FRAMES_IN_FLIGHT] = {};
+    bool cameraDirty = true;
+
+    // Non-instanced path: model matrices of the visible objects in draw order, and which objects are visible
+    std::vector<glm::mat4> drawModels;
+    std::vector<uint32_t> visibilityMask;
+
+    // Instanced path: a persistently mapped ring with a region of MAX_INSTANCES transforms per frame in flight
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    Allocation memoryInstanceBuffer;
+
+    // Object state as structure of arrays, the input of the batched transform kernel (see transform_batch.hpp)
+    struct SceneObjects {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> angle;
+        std::vector<float> scale;
+        std::vector<float> radius;
+    };
+    SceneObjects sceneObjects;
+    uint32_t sceneObjectCount = 0;
+    uint32_t visibleObjectCount = 0;
+    float sceneAngle = 0.0f;
+    TransformKernel transformKernel = detectTransformKernel();
+
+    // GPU-driven path: a compute pass writes the instance transforms and one VkDrawIndexedIndirectCommand per visible object,
+    // so recording costs the same for any object count. Only enabled when the device supports it, see createDevice().
+    bool gpuCulling = false;
+    // Compacted commands plus a count written by the GPU; without it every object keeps a command, culled ones with no instance
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+    VkDeviceSize drawCountStride = 4;
+
+    // Must match shaders/cull.comp
+    struct CullConstants {
+        glm::vec4 frustumPlanes[6];
+        float angle;
+        float boundingRadius;
+        uint32_t objectCount;
+        uint32_t indexCount;
+        uint32_t compact;
+    };
+    const uint32_t CULL_GROUP_SIZE = 64;
+
+    VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+    VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline cullPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool cullDescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet cullDescriptorSets[MAX_FRAMES_IN_FLIGHT];
+    // Placement of every object (x, y, z, scale), uploaded once
+    VkBuffer objectBuffer = VK_NULL_HANDLE;
+    Allocation memoryObjectBuffer;
+    // A command region per frame in flight, followed by a draw count slot per frame in flight
+    VkBuffer indirectBuffer = VK_NULL_HANDLE;
+    Allocation memoryIndirectBuffer;
     
-    VkImage textureImage;
-    VkDeviceMemory memoryTextureImage;
+    // Shown until the first texture levels are resident, then handed to the deletion queue
+    VkImage placeholderImage = VK_NULL_HANDLE;
+    Allocation memoryPlaceholderImage;
+    VkImageView placeholderImageView = VK_NULL_HANDLE;
+
+    VkImage textureImage = VK_NULL_HANDLE;
+    Allocation memoryTextureImage;
     VkImageView textureImageView;
     VkSampler textureSampler;
+    VkFormat textureFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    uint32_t textureMipLevels = 1;
+
+    // Levels 1.. of an uploaded image still to be blitted from level 0 on the graphics queue, once `ticket` is submitted
+    struct MipGeneration {
+        VkImage image;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint64_t ticket;
+    };
+    std::vector<MipGeneration> pendingMipGenerations;
+
+    // Streaming: levels [residentLevel, mipLevels) are sampled; the next finer level is uploaded in a batch of its own. The
+    // source levels (in a cooked asset or a chain built at load time) are kept until every level is resident.
+    struct TextureStream {
+        Asset source;
+        MipChain chain;
+        std::vector<MipLevel> levels;
+        const uint8_t* data = nullptr;
+        uint32_t residentLevel = 0;
+        uint32_t pendingLevel = 0;
+        uint64_t pendingTicket = 0;
+        bool active = false;
+    };
+    TextureStream textureStream;
+    AssetPack assetPack;
+    AssetStats assetStats;
+
+    // A texture decoded on a worker; `levels` point into `data`, which is owned by `source` or `chain`
+    struct DecodedTexture {
+        Asset source;
+        MipChain chain;
+        std::vector<MipLevel> levels;
+        const uint8_t* data = nullptr;
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t mipLevels = 1;
+        // Only level 0 is decoded; the others are blitted on the GPU
+        bool generateMipmaps = false;
+        std::string description;
+        std::string error;
+        AssetStats stats;
+        double milliseconds = 0.0;
+    };
+    TaskQueue decodeQueue;
+    std::mutex decodedMutex;
+    std::vector<DecodedTexture> decodedTextures;
+    std::chrono::high_resolution_clock::time_point textureRequestTime;
     
     VkDescriptorPool descriptorPool;
-    std::vector<VkDescriptorSet> descriptorSets;
+    VkDescriptorSet descriptorSet;
+
+    // Bindless path: set 1 of the graphics pipeline layout, with the texture in slot textureSlot. Only enabled when the device
+    // supports descriptor indexing, see createDevice(); otherwise set 0 carries the texture and is replaced with it.
+    bool bindless = false;
+    uint32_t bindlessTextureCapacity = 0;
+    BindlessTable bindlessTable;
+    uint32_t textureSlot = 0;
+
         
-    VkCommandPool commandPool;
-    std::vector<VkCommandBuffer> commandBuffers;
+    // Each frame in flight owns a pool that is reset as a whole once its previous frame has completed; nothing is freed individually
+    struct FrameCommands {
+        VkCommandPool commandPool;
+        VkCommandBuffer commandBuffer;
+    };
+    FrameCommands frameCommands[MAX_FRAMES_IN_FLIGHT];
+
+    // Per worker thread and frame in flight: a pool only that thread records from, and the secondaries handed out this frame
+    struct WorkerCommands {
+        VkCommandPool commandPool;
+        std::vector<VkCommandBuffer> secondaryBuffers;
+        uint32_t usedSecondaryBuffers = 0;
+    };
+    std::vector<WorkerCommands> workerCommands[MAX_FRAMES_IN_FLIGHT];
+    JobSystem jobs;
+
+    double recordTimeTotal = 0.0;
+    uint64_t recordedFrames = 0;
+    std::optional<std::chrono::high_resolution_clock::time_point> lastFrameStart;
+
+    // What gets recorded each frame; rebuilt by updateScene()
+    struct DrawItem {
+        uint32_t object;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t instanceCount;
+        uint32_t firstInstance;
+    };
+    std::vector<DrawItem> drawList;
 
+    // Acquire signals a binary semaphore per frame slot; present waits on one per swapchain image, which is only reused once
+    // the image has been presented and acquired again
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
-    std::vector<VkFence> imagesInFlight;
+    // Frame N signals value N when its commands complete; all CPU waits and retirement of per-frame objects key off it
+    TimelineSemaphore frameTimeline;
     
     size_t currentFrame = 0;
+    // Frames submitted so far, i.e. the frame timeline value of the last submission
+    uint64_t frameNumber = 0;
+    FrameLimiter frameLimiter;
+    // When the input of the frame being rendered was polled; "input latency" runs from here to present submission
+    std::chrono::high_resolution_clock::time_point inputSampleTime;
 
     bool framebufferResized = false;
 
+    // Objects replaced while frames are in flight (swapchains, texture views, the placeholder texture), keyed by the frame
+    // timeline value of the last frame that may use them
+    DeletionQueue deletionQueue;
+
     void setupVulkan() {
+        openAssetPack();
         configVulkan();
         createInstance();
         createDebugMessenger();
         createSurface();
         selectPhysicalDevice();
         createDevice();
-        createSwapchain();
+        createRenderTargets();
         createSwapchainImageViews();
         createRenderPass();
         createDescriptorSetLayout();
+        if (bindless) {
+            bindlessTable.init(device, &allocator, bindlessTextureCapacity);
+        }
+        createPipelineLayout();
+        // The pipeline's vertex input follows the layout the mesh was packed in
+        loadMesh();
         createGraphicsPipeline();
         createFramebuffers();
-        createCommandPool();
+        if (options.recordThreads > 0) {
+            jobs.init(options.recordThreads);
+        }
+        createCommandPools();
         createVertexBuffer();
         createIndexBuffer();
         createUniformBuffers();
-        createTextureImage();
-        createTextureImageView();
+        if (options.instanced) {
+            createInstanceBuffer();
+        }
+        if (gpuCulling) {
+            createCullingResources();
+        }
+        createPlaceholderTexture();
+        // All startup uploads go out as one batch; the first frame waits on it on the GPU, not the CPU
+        transfer.submit();
+        decodeQueue.init(options.decodeThreads);
+        requestTextureLoad();
         createTextureSampler();
         createDescriptorPool();
         createDescriptorSets();
         createCommandBuffers();
         createSemaphores();
-        createFences();
+
+        allocator.logStats();
     }
 
     void refreshSwapchain() {
@@ -296,61 +574,139 @@ private:
             glfwWaitEvents();
         }
 
-        vkDeviceWaitIdle(device);
-
-        cleanupSwapchainRelated();
-
-        // recreate swapchain and related objects
+        // No device idle: frames still in flight keep using the old objects, which are destroyed once they are done
+        auto startTime = std::chrono::high_resolution_clock::now();
+        VkSwapchainKHR oldSwapchain = swapchain;
+        std::vector<VkImageView> oldImageViews = std::move(swapchainImageViews);
+        std::vector<VkFramebuffer> oldFramebuffers = std::move(swapchainFramebuffers);
+        // Presents of old images may still wait on these; the new images get a fresh set
+        std::vector<VkSemaphore> oldRenderFinishedSemaphores = std::move(renderFinishedSemaphores);
+        renderFinishedSemaphores.clear();
+        VkRenderPass oldRenderPass = VK_NULL_HANDLE;
+        VkPipeline oldGraphicsPipeline = VK_NULL_HANDLE;
+        VkFormat previousFormat = swapchainImageFormat;
+
+        // createSwapchain() hands the current swapchain over as oldSwapchain
         createSwapchain();
         createSwapchainImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
+        // Viewport and scissor are dynamic, so the pipeline only depends on the render pass, i.e. on the format
+        if (swapchainImageFormat != previousFormat) {
+            oldRenderPass = renderPass;
+            oldGraphicsPipeline = graphicsPipeline;
+            createRenderPass();
+            createGraphicsPipeline();
+        }
         createFramebuffers();
-        createUniformBuffers();
-        createDescriptorPool();
-        createDescriptorSets();
-        createCommandBuffers();
+        createRenderFinishedSemaphores();
+        // Once a frame submitted after the switch has completed, the old swapchain's last frames and presents are behind it
+        deletionQueue.push(frameNumber + 1, [this, oldSwapchain, oldImageViews, oldFramebuffers, oldRenderFinishedSemaphores, oldRenderPass, oldGraphicsPipeline]() {
+            for (auto& framebuffer : oldFramebuffers) {
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            }
+            for (auto& imageView : oldImageViews) {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
+            if (oldGraphicsPipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(device, oldGraphicsPipeline, nullptr);
+                vkDestroyRenderPass(device, oldRenderPass, nullptr);
+            }
+            for (auto semaphore : oldRenderFinishedSemaphores) {
+                vkDestroySemaphore(device, semaphore, nullptr);
+            }
+            vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+        });
+
+        cameraDirty = true;
+        float timeElapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        LOG("Swapchain Refreshed: (%d x %d) in %.3f ms\n", swapchainImageExtent.width, swapchainImageExtent.height, timeElapsed);
     }
 
     void cleanup() {        
+        // Decodes still running reference the asset pack
+        decodeQueue.destroy();
         cleanupSwapchainRelated();
+        assetPack.close();
 
         vkDestroySampler(device, textureSampler, nullptr);
-        vkDestroyImageView(device, textureImageView, nullptr);
+        if (textureImageView != placeholderImageView) {
+            vkDestroyImageView(device, textureImageView, nullptr);
+        }
+        vkDestroyImageView(device, placeholderImageView, nullptr);
+        vkDestroyImage(device, placeholderImage, nullptr);
+        allocator.free(memoryPlaceholderImage);
         vkDestroyImage(device, textureImage, nullptr);
-        vkFreeMemory(device, memoryTextureImage, nullptr);
+        allocator.free(memoryTextureImage);
 
+        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
         vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+        if (bindless) {
+            bindlessTable.destroy();
+        }
+
+        vkDestroyPipeline(device, cullPipeline, nullptr);
+        vkDestroyPipelineLayout(device, cullPipelineLayout, nullptr);
+        vkDestroyDescriptorPool(device, cullDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, cullDescriptorSetLayout, nullptr);
+        vkDestroyBuffer(device, indirectBuffer, nullptr);
+        allocator.free(memoryIndirectBuffer);
+        vkDestroyBuffer(device, objectBuffer, nullptr);
+        allocator.free(memoryObjectBuffer);
+        vkDestroyBuffer(device, instanceBuffer, nullptr);
+        allocator.free(memoryInstanceBuffer);
+        vkDestroyBuffer(device, uniformBuffer, nullptr);
+        allocator.free(memoryUniformBuffer);
 
         vkDestroyBuffer(device, indexBuffer, nullptr);
-        vkFreeMemory(device, memoryIndexBuffer, nullptr);
+        allocator.free(memoryIndexBuffer);
         vkDestroyBuffer(device, vertexBuffer, nullptr);
-        vkFreeMemory(device, memoryVertexBuffer, nullptr);
+        allocator.free(memoryVertexBuffer);
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkDestroyFence(device, inFlightFences[i], nullptr);
-            vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
-            vkDestroySemaphore(device, imageAvailableSemaphores[i], nullptr);
+        for (auto semaphore : imageAvailableSemaphores) {
+            vkDestroySemaphore(device, semaphore, nullptr);
         }
+        for (auto semaphore : renderFinishedSemaphores) {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        frameTimeline.destroy();
 
-        vkDestroyCommandPool(device, commandPool, nullptr);
+        for (auto& frame : frameCommands) {
+            vkDestroyCommandPool(device, frame.commandPool, nullptr);
+        }
+        for (auto& workers : workerCommands) {
+            for (auto& worker : workers) {
+                vkDestroyCommandPool(device, worker.commandPool, nullptr);
+            }
+        }
+        if (options.recordThreads > 0) {
+            jobs.destroy();
+        }
 
+        transfer.destroy();
+        profiler.destroy();
+        pipelineCache.destroy();
+        allocator.logStats();
+        allocator.destroy();
         vkDestroyDevice(device, nullptr);
         teardownDebugMessenger();
-        vkDestroySurfaceKHR(instance, surface, nullptr);
+        if (!options.headless) {
+            vkDestroySurfaceKHR(instance, surface, nullptr);
+        }
         vkDestroyInstance(instance, nullptr);
 
-        glfwDestroyWindow(window);
-        glfwTerminate();
+        if (!options.headless) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
     }
 
     void cleanupSwapchainRelated() {
+        // The device is idle: everything still queued can go
+        deletionQueue.flush();
+
         for (auto& framebuffer : swapchainFramebuffers) {
             vkDestroyFramebuffer(device, framebuffer, nullptr);
         }
 
-        vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-        
         vkDestroyPipeline(device, graphicsPipeline, nullptr);
         vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
         vkDestroyRenderPass(device, renderPass, nullptr);
@@ -359,21 +715,23 @@ private:
             vkDestroyImageView(device, swapchainImageViews[i], nullptr);
         }
 
-        vkDestroySwapchainKHR(device, swapchain, nullptr);
-        
-        for (size_t i = 0; i < swapchainImages.size(); i++) {
-            vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-            vkFreeMemory(device, memoryUniformBuffers[i], nullptr);
+        if (options.headless) {
+            for (size_t i = 0; i < swapchainImages.size(); i++) {
+                vkDestroyImage(device, swapchainImages[i], nullptr);
+                allocator.free(memoryOffscreenImages[i]);
+            }
+        } else {
+            vkDestroySwapchainKHR(device, swapchain, nullptr);
         }
-
-        vkDestroyDescriptorPool(device, descriptorPool, nullptr);
     }
 
     void configVulkan() {
         if (ENABLE_VALIDATION_LAYER) {
             desiredLayers.emplace_back("VK_LAYER_KHRONOS_validation");
         }
-        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        if (!options.headless) {
+            deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
     }
 
     void createInstance() {
@@ -386,7 +744,8 @@ private:
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "No Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // 1.2 for timeline semaphores; on older devices they come from VK_KHR_timeline_semaphore
+        appInfo.apiVersion = VK_API_VERSION_1_2;
         createInfo.pApplicationInfo = &appInfo;
 
         // ToDo: check validation layers availability
@@ -396,10 +755,14 @@ private:
         // Print available extensions
         getVulkanInstanceExtensions();
         // Enable extensions
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        // GLFW is never initialized in headless mode, so surface extensions are not requested
+        std::vector<const char*> extensions;
+        if (!options.headless) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
         if (ENABLE_DEBUG_MESSENGER) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         }
@@ -486,6 +849,9 @@ private:
     }
 
     void createSurface() {
+        if (options.headless) {
+            return;
+        }
         vkCritical(glfwCreateWindowSurface(instance, window, nullptr, &surface));
     }
 
@@ -536,6 +902,16 @@ private:
             return 0;
         }
 
+        // Frame and upload synchronization is built on timeline semaphores
+        if (!supportsTimelineSemaphores(device)) {
+            LOG("\tNo timeline semaphore support\n");
+            return 0;
+        }
+
+        if (options.headless) {
+            return score;
+        }
+
         swapchainDetails.getSwapchainDetails(device, surface);
         if (swapchainDetails.isComplete()) {
             score += 1;
@@ -546,6 +922,60 @@ private:
         return score;
     }
 
+    bool isDeviceExtensionSupported(const VkPhysicalDevice& device, const char* name) {
+        uint32_t extensionCount;
+        vkCritical(vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr));
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkCritical(vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data()));
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, name) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Core in 1.2; the extension needs 1.1 (or VK_KHR_get_physical_device_properties2, which the instance does not enable)
+    bool supportsTimelineSemaphores(const VkPhysicalDevice& device) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        return deviceProperties.apiVersion >= VK_API_VERSION_1_2
+            || (deviceProperties.apiVersion >= VK_API_VERSION_1_1 && isDeviceExtensionSupported(device, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME));
+    }
+
+    // Core in 1.2 with optional features, otherwise VK_EXT_descriptor_indexing; `textureCapacity` is set to the number of
+    // update-after-bind sampled images the bindless array can hold
+    bool supportsDescriptorIndexing(const VkPhysicalDevice& device, uint32_t& textureCapacity) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+        if (deviceProperties.apiVersion < VK_API_VERSION_1_2
+            && (deviceProperties.apiVersion < VK_API_VERSION_1_1 || !isDeviceExtensionSupported(device, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME))) {
+            return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(device, &features);
+        if (!features.features.shaderSampledImageArrayDynamicIndexing || !indexingFeatures.shaderSampledImageArrayNonUniformIndexing
+            || !indexingFeatures.runtimeDescriptorArray || !indexingFeatures.descriptorBindingPartiallyBound
+            || !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind || !indexingFeatures.descriptorBindingUpdateUnusedWhilePending) {
+            return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(device, &properties);
+        textureCapacity = std::min({BINDLESS_MAX_TEXTURES, indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages});
+        return textureCapacity > 0;
+    }
+
     bool evaluateDeviceExtensions(const VkPhysicalDevice& device) {
         uint32_t extensionCount;
         vkCritical(vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr));
@@ -563,7 +993,11 @@ private:
         deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.surfaceFamily.value()};
+        std::set<uint32_t> uniqueQueueFamilies = {queueFamilyIndices.graphicsFamily.value()};
+        if (queueFamilyIndices.surfaceFamily.has_value()) {
+            uniqueQueueFamilies.insert(queueFamilyIndices.surfaceFamily.value());
+        }
+        uniqueQueueFamilies.insert(queueFamilyIndices.transferFamily.value());
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
             VkDeviceQueueCreateInfo queueCreateInfo{};
@@ -576,10 +1010,75 @@ private:
         deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+        // Software rasterizers may lack anisotropic filtering; the sampler falls back to plain linear filtering. Without BC
+        // support, cooked textures are decompressed on load.
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
         VkPhysicalDeviceFeatures deviceFeatures{};
-        deviceFeatures.samplerAnisotropy = VK_TRUE;
+        deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+        deviceFeatures.fullDrawIndexUint32 = supportedFeatures.fullDrawIndexUint32;
+
+        // GPU culling issues one indirect command per object, each selecting its transform through firstInstance
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        if (options.gpuCulling) {
+            gpuCulling = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance && deviceProperties.limits.maxDrawIndirectCount >= MAX_INSTANCES;
+            if (!gpuCulling) {
+                LOG("GPU Culling: multi-draw indirect is not supported, falling back to CPU instancing\n");
+            }
+        }
+        deviceFeatures.multiDrawIndirect = gpuCulling ? VK_TRUE : VK_FALSE;
+        deviceFeatures.drawIndirectFirstInstance = gpuCulling ? VK_TRUE : VK_FALSE;
+        bool drawIndirectCount = gpuCulling && isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        if (drawIndirectCount) {
+            deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
         deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 
+        // Required (see supportsTimelineSemaphores()): the same feature struct serves the core feature and the extension
+        VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+        timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+        bool timelineCore = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+        if (!timelineCore) {
+            deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+        }
+        deviceCreateInfo.pNext = &timelineSemaphoreFeatures;
+
+        // Optional: lets the profiler reset timestamp queries used on a transfer-only queue from the host
+        VkPhysicalDeviceHostQueryResetFeaturesEXT hostQueryResetFeatures{};
+        hostQueryResetFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_QUERY_RESET_FEATURES_EXT;
+        bool hostQueryReset = isDeviceExtensionSupported(physicalDevice, VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+        if (hostQueryReset) {
+            deviceExtensions.push_back(VK_EXT_HOST_QUERY_RESET_EXTENSION_NAME);
+            hostQueryResetFeatures.hostQueryReset = VK_TRUE;
+            timelineSemaphoreFeatures.pNext = &hostQueryResetFeatures;
+        }
+
+        // Optional (--bindless): the texture array is indexed per instance (non-uniform within a draw) and updated while bound
+        VkPhysicalDeviceDescriptorIndexingFeatures descriptorIndexingFeatures{};
+        descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        if (options.bindless) {
+            bindless = supportsDescriptorIndexing(physicalDevice, bindlessTextureCapacity);
+            if (!bindless) {
+                LOG("Bindless: descriptor indexing is not supported, falling back to a descriptor set per texture\n");
+            }
+        }
+        if (bindless) {
+            deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+            descriptorIndexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            descriptorIndexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+                deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            }
+            descriptorIndexingFeatures.pNext = timelineSemaphoreFeatures.pNext;
+            timelineSemaphoreFeatures.pNext = &descriptorIndexingFeatures;
+            LOG("Bindless: %u texture slots, %u materials per frame in flight\n", bindlessTextureCapacity, BINDLESS_MAX_MATERIALS);
+        }
+
         // Device validation layers are ignored by modern Vulkan implementation
         if (ENABLE_VALIDATION_LAYER) {
             deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(deviceExtensions.size());
@@ -592,16 +1091,64 @@ private:
 
         vkCritical(vkCreateDevice(physicalDevice, &deviceCreateInfo, nullptr, &device));
 
+        allocator.init(physicalDevice, device);
+
         vkGetDeviceQueue(device, queueFamilyIndices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, queueFamilyIndices.surfaceFamily.value(), 0, &presentQueue);
+        if (queueFamilyIndices.surfaceFamily.has_value()) {
+            vkGetDeviceQueue(device, queueFamilyIndices.surfaceFamily.value(), 0, &presentQueue);
+        }
+        vkGetDeviceQueue(device, queueFamilyIndices.transferFamily.value(), 0, &transferQueue);
+
+        PFN_vkResetQueryPoolEXT hostResetQueryPool = hostQueryReset ? reinterpret_cast<PFN_vkResetQueryPoolEXT>(vkGetDeviceProcAddr(device, "vkResetQueryPoolEXT")) : nullptr;
+        profiler.init(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.transferFamily.value(), hostResetQueryPool);
+        TimelineFunctions timelineFunctions;
+        timelineFunctions.waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphoresKHR>(vkGetDeviceProcAddr(device, timelineCore ? "vkWaitSemaphores" : "vkWaitSemaphoresKHR"));
+        timelineFunctions.getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValueKHR>(vkGetDeviceProcAddr(device, timelineCore ? "vkGetSemaphoreCounterValue" : "vkGetSemaphoreCounterValueKHR"));
+        frameTimeline.init(device, timelineFunctions);
+        transfer.init(device, &allocator, &profiler, timelineFunctions, queueFamilyIndices.transferFamily.value(), transferQueue, queueFamilyIndices.hasDedicatedTransfer(),
+            deviceProperties.limits.optimalBufferCopyOffsetAlignment);
+        LOG("Transfer Queue Family: %u (%s)\n", queueFamilyIndices.transferFamily.value(), queueFamilyIndices.hasDedicatedTransfer() ? "dedicated" : "shared with graphics");
+
+        pipelineCache.init(physicalDevice, device, PIPELINE_CACHE_PATH);
+
+        if (drawIndirectCount) {
+            cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        }
+        if (gpuCulling) {
+            // The counters are bound to the culling pass as storage buffers in both modes, so their offsets must be aligned
+            drawCountStride = std::max<VkDeviceSize>(deviceProperties.limits.minStorageBufferOffsetAlignment, 4);
+            LOG("GPU Culling: %s\n", drawIndirectCount ? "compacted commands, GPU draw count" : "a command per object");
+        }
+    }
+
+    void createRenderTargets() {
+        if (options.headless) {
+            createOffscreenTargets();
+        } else {
+            createSwapchain();
+        }
+    }
+
+    // Headless counterpart of createSwapchain(): one device-local color target per frame in flight
+    void createOffscreenTargets() {
+        swapchainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+        swapchainImageExtent = {WIDTH, HEIGHT};
+
+        swapchainImages.resize(framesInFlight);
+        memoryOffscreenImages.resize(framesInFlight);
+        for (size_t i = 0; i < swapchainImages.size(); i++) {
+            createImage(WIDTH, HEIGHT, 1, swapchainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapchainImages[i], memoryOffscreenImages[i]);
+        }
+        LOG("Headless Render Targets: %zu x (%d x %d)\n", swapchainImages.size(), swapchainImageExtent.width, swapchainImageExtent.height);
     }
 
     void createSwapchain() {
         swapchainDetails.getSwapchainDetails(physicalDevice, surface);
         VkSurfaceFormatKHR surfaceFormat = selectSurfaceFormat(swapchainDetails.formats);
-        VkPresentModeKHR presentMode = selectPresentMode(swapchainDetails.presentModes);
+        VkPresentModeKHR presentMode = selectPacingPresentMode(options.pacing, swapchainDetails.presentModes);
         VkExtent2D extent = selectSwapchainExtent(swapchainDetails.capabilities);
-        uint32_t imageCount = swapchainDetails.capabilities.minImageCount + 1;
+        // An extra image lets the CPU start on the next frame before the display releases one; the latency mode does without
+        uint32_t imageCount = swapchainDetails.capabilities.minImageCount + (options.pacing == PacingMode::Latency ? 0 : 1);
         if (swapchainDetails.capabilities.maxImageCount > 0 && imageCount > swapchainDetails.capabilities.maxImageCount) {
             imageCount = swapchainDetails.capabilities.maxImageCount;
         }
@@ -631,14 +1178,15 @@ private:
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = presentMode;
         createInfo.clipped = VK_TRUE;
-        // Only ever create one swapchain; Never resize
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        // Lets the driver reuse resources of the swapchain being replaced; the caller retires the old one
+        createInfo.oldSwapchain = swapchain;
 
         vkCritical(vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain));
 
         vkCritical(vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr)); 
         swapchainImages.resize(imageCount);
         vkCritical(vkGetSwapchainImagesKHR(device, swapchain, &imageCount, swapchainImages.data()));
+        LOG("Present Mode: %s, %u images\n", presentModeName(presentMode), imageCount);
 
         swapchainImageFormat = surfaceFormat.format;
         swapchainImageExtent = extent;
@@ -653,16 +1201,6 @@ private:
             return availableFormats[0];
         }
 
-    VkPresentModeKHR selectPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-                return availablePresentMode;
-            }
-        }
-        // VK_PRESENT_MODE_FIFO_KHR is guaranteed to be available
-        return VK_PRESENT_MODE_FIFO_KHR;
-    }
-
     VkExtent2D selectSwapchainExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
         if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() && capabilities.currentExtent.height != std::numeric_limits<uint32_t>::max()) { 
             LOG("Current Swapchain Extent: (%d x %d)\n", capabilities.currentExtent.width, capabilities.currentExtent.height);
@@ -684,7 +1222,7 @@ private:
         }
     }
 
-    void createImageView(VkImageView& imageView, VkImage& image, VkFormat format) {
+    void createImageView(VkImageView& imageView, VkImage& image, VkFormat format, uint32_t baseMipLevel = 0, uint32_t levelCount = 1) {
         VkImageViewCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         createInfo.image = image;
@@ -695,8 +1233,8 @@ private:
         createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
         createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
         createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        createInfo.subresourceRange.baseMipLevel = 0;
-        createInfo.subresourceRange.levelCount = 1;
+        createInfo.subresourceRange.baseMipLevel = baseMipLevel;
+        createInfo.subresourceRange.levelCount = levelCount;
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
         vkCritical(vkCreateImageView(device, &createInfo, nullptr, &imageView));
@@ -714,7 +1252,8 @@ private:
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Offscreen targets are left ready to be copied out instead of presented
+        colorAttachment.finalLayout = options.headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
                 
         createInfo.attachmentCount = 1;
         createInfo.pAttachments = &colorAttachment;
@@ -746,14 +1285,9 @@ private:
     }
 
     void createGraphicsPipeline() {
-        std::vector<int8_t> vShaderCode;
-        std::vector<int8_t> fShaderCode;
-        readFileAsByteArray("build/vertex.spv", vShaderCode);
-        readFileAsByteArray("build/fragment.spv", fShaderCode);
-
         VkShaderModule vShaderModule, fShaderModule;
-        createShaderModule(vShaderCode, vShaderModule);
-        createShaderModule(fShaderCode, fShaderModule);
+        createShaderModule(options.instanced ? "build/instanced.spv" : "build/vertex.spv", vShaderModule);
+        createShaderModule(bindless ? "build/bindless.spv" : "build/fragment.spv", fShaderModule);
 
         VkPipelineShaderStageCreateInfo vShaderStageCreateInfo{};
         vShaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -771,11 +1305,20 @@ private:
 
         // Following are fixed (non-programmable) stages, still we need to create them explicitly
         VkPipelineVertexInputStateCreateInfo vertexInputStageCreateInfo{};
-        auto bindingDescription = Vertex::getBindingDescription();
-        auto attributeDescriptions = Vertex::getAttributeDescriptions();
+        VkVertexInputBindingDescription vertexBindingDescription;
+        vertexBindingDescription.binding = 0;
+        vertexBindingDescription.stride = vertexStride;
+        vertexBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions = {vertexBindingDescription};
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
+        if (options.instanced) {
+            auto instanceAttributeDescriptions = InstanceData::getAttributeDescriptions();
+            bindingDescriptions.push_back(InstanceData::getBindingDescription());
+            attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributeDescriptions.begin(), instanceAttributeDescriptions.end());
+        }
         vertexInputStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputStageCreateInfo.vertexBindingDescriptionCount = 1;
-        vertexInputStageCreateInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputStageCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputStageCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputStageCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertexInputStageCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -784,23 +1327,19 @@ private:
         inputAssemblyStateCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssemblyStateCreateInfo.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport{};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = static_cast<float>(swapchainImageExtent.width);
-        viewport.height = static_cast<float>(swapchainImageExtent.height);
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0f;
-        VkRect2D scissor{};
-        scissor.offset = {0, 0};
-        scissor.extent = swapchainImageExtent;
-
+        // Viewport and scissor are set while recording, so a resize does not invalidate the pipeline
         VkPipelineViewportStateCreateInfo viewportStateCreateInfo{};
         viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportStateCreateInfo.viewportCount = 1;
-        viewportStateCreateInfo.pViewports = &viewport;
+        viewportStateCreateInfo.pViewports = nullptr; // dynamic
         viewportStateCreateInfo.scissorCount = 1;
-        viewportStateCreateInfo.pScissors = &scissor;
+        viewportStateCreateInfo.pScissors = nullptr; // dynamic
+
+        VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{};
+        dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicStateCreateInfo.dynamicStateCount = 2;
+        dynamicStateCreateInfo.pDynamicStates = dynamicStates;
 
         VkPipelineRasterizationStateCreateInfo rasterizationStateCreateInfo{};
         rasterizationStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -849,14 +1388,6 @@ private:
         colorBlendStateCreateInfo.blendConstants[2] = 0.0f; // optional
         colorBlendStateCreateInfo.blendConstants[3] = 0.0f; // optional
 
-        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
-        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutCreateInfo.setLayoutCount = 1;
-        pipelineLayoutCreateInfo.pSetLayouts = &descriptorSetLayout;
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 0; // optional
-        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr; // optional
-        vkCritical(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
-
         VkGraphicsPipelineCreateInfo pipelineCreateInfo{};
         pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
         pipelineCreateInfo.stageCount = 2;
@@ -868,42 +1399,82 @@ private:
         pipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
         pipelineCreateInfo.pDepthStencilState = nullptr; // optional
         pipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-        pipelineCreateInfo.pDynamicState = nullptr; // optional
+        pipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
         pipelineCreateInfo.layout = pipelineLayout;
         pipelineCreateInfo.renderPass = renderPass;
         pipelineCreateInfo.subpass = 0;
         pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE; // optional
         pipelineCreateInfo.basePipelineIndex = -1; // optional
 
-        vkCritical(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &graphicsPipeline));
+        bool warmCache = pipelineCache.isWarm();
+        auto startTime = std::chrono::high_resolution_clock::now();
+        vkCritical(vkCreateGraphicsPipelines(device, pipelineCache.handle(), 1, &pipelineCreateInfo, nullptr, &graphicsPipeline));
+        float timeElapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        pipelineCache.markWarm();
+        LOG("Graphics Pipeline: created in %.3f ms (%s cache)\n", timeElapsed, warmCache ? "warm" : "cold");
 
         vkDestroyShaderModule(device, fShaderModule, nullptr);
         vkDestroyShaderModule(device, vShaderModule, nullptr);
     }
 
-    void readFileAsByteArray(const std::string& filepath, std::vector<int8_t>& buffer) {
-        std::ifstream ifs(filepath, std::ios::ate | std::ios::binary);
-        if (!ifs.is_open()) {
-            throw std::runtime_error("Failed to open the file.\n");
+    void createPipelineLayout() {
+        VkDescriptorSetLayout setLayouts[] = {descriptorSetLayout, bindless ? bindlessTable.getLayout() : VK_NULL_HANDLE};
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(DrawConstants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = bindless ? 2 : 1;
+        pipelineLayoutCreateInfo.pSetLayouts = setLayouts;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        vkCritical(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &pipelineLayout));
+    }
+
+    // The pack is mapped before anything else, and the larger assets are prefetched so their reads overlap device creation
+    void openAssetPack() {
+        if (!assetPack.open(ASSET_PACK_PATH)) {
+            LOG("Asset Pack: no pack at %s, loading loose files\n", ASSET_PACK_PATH);
+            return;
         }
+        assetStats.addFile();
+        assetPack.prefetch(COOKED_TEXTURE_PATH);
+        LOG("Asset Pack: %zu assets, %.1f KiB in %s\n", assetPack.getEntryCount(), assetPack.getSize() / 1024.0, ASSET_PACK_PATH);
+    }
 
-        size_t filesize = (size_t) ifs.tellg();
-        buffer.resize(filesize);
-        ifs.seekg(0);
-        ifs.read(reinterpret_cast<char*>(buffer.data()), filesize);
-        if (ifs.fail()) {
-            throw std::runtime_error("Failed to read the file.\n");
+    // From the pack when it has the asset, otherwise from the loose file at the same relative path
+    // Safe to call from worker threads: the pack is only read, and the counters go to the caller's `stats`
+    bool loadAsset(const std::string& path, Asset& asset, AssetStats& stats, bool sequential = false) const {
+        if (assetPack.isOpen() && assetPack.load(path, asset, stats)) {
+            return true;
+        }
+        if (!asset.file.open(path, sequential)) {
+            return false;
         }
-        ifs.close();
+        stats.addFile();
+        stats.addRead(asset.file.size());
+        asset.data = asset.file.data();
+        asset.size = asset.file.size();
+        return true;
     }
 
-    void createShaderModule(const std::vector<int8_t>& code, VkShaderModule& shaderModule) {
+    // SPIR-V is handed to the driver straight from the mapping; mappings and pack entries are aligned as pCode requires
+    void createShaderModule(const std::string& filepath, VkShaderModule& shaderModule) {
+        auto start = std::chrono::high_resolution_clock::now();
+        Asset asset;
+        if (!loadAsset(filepath, asset, assetStats, true)) {
+            throw std::runtime_error("Failed to open the file.\n");
+        }
+
         VkShaderModuleCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        createInfo.codeSize = asset.size;
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(asset.data);
 
         vkCritical((vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule)));
+        assetStats.addTime(std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
     }
 
     void createFramebuffers() {
@@ -924,180 +1495,511 @@ private:
         }
     }
 
-    void createCommandPool() {
+    void createCommandPools() {
         VkCommandPoolCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         createInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        createInfo.flags = 0; // optional
-        vkCritical(vkCreateCommandPool(device, &createInfo, nullptr, &commandPool));
+        // Command buffers live for one frame and are recycled by resetting the whole pool
+        createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        for (auto& frame : frameCommands) {
+            vkCritical(vkCreateCommandPool(device, &createInfo, nullptr, &frame.commandPool));
+        }
+        for (auto& workers : workerCommands) {
+            workers.resize(options.recordThreads);
+            for (auto& worker : workers) {
+                vkCritical(vkCreateCommandPool(device, &createInfo, nullptr, &worker.commandPool));
+            }
+        }
+    }
+
+    void resetCommandPools(size_t frame) {
+        vkCritical(vkResetCommandPool(device, frameCommands[frame].commandPool, 0));
+        for (auto& worker : workerCommands[frame]) {
+            vkCritical(vkResetCommandPool(device, worker.commandPool, 0));
+            worker.usedSecondaryBuffers = 0;
+        }
+    }
+
+    // Called from the worker's own thread only; secondaries are allocated once and recycled with their pool
+    VkCommandBuffer acquireSecondaryBuffer(size_t frame, uint32_t worker) {
+        WorkerCommands& commands = workerCommands[frame][worker];
+        if (commands.usedSecondaryBuffers == commands.secondaryBuffers.size()) {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = commands.commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocateInfo.commandBufferCount = 1;
+            VkCommandBuffer commandBuffer;
+            vkCritical(vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer));
+            commands.secondaryBuffers.push_back(commandBuffer);
+        }
+        return commands.secondaryBuffers[commands.usedSecondaryBuffers++];
     }
 
     void createCommandBuffers() {
-        commandBuffers.resize(swapchainFramebuffers.size());
-        VkCommandBufferAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.commandPool = commandPool;
-        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-        vkCritical(vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()));
-
-        for (size_t i = 0; i < commandBuffers.size(); i++) {
-            VkCommandBufferBeginInfo commandBufferBeginInfo{};
-            commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            commandBufferBeginInfo.flags = 0; // optional
-            commandBufferBeginInfo.pInheritanceInfo = nullptr; // optional
-            vkCritical(vkBeginCommandBuffer(commandBuffers[i], &commandBufferBeginInfo));
-        
-            VkRenderPassBeginInfo renderPassBeginInfo{};
-            renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassBeginInfo.renderPass = renderPass;
-            renderPassBeginInfo.framebuffer = swapchainFramebuffers[i];
-            renderPassBeginInfo.renderArea.offset = {0, 0};
-            renderPassBeginInfo.renderArea.extent = swapchainImageExtent;
-            VkClearValue clearColor = {1.0f, 1.0f, 1.0f, 1.0f};
-            renderPassBeginInfo.clearValueCount = 1;
-            renderPassBeginInfo.pClearValues = &clearColor;
-
-            // vk commands are predefined here
-            vkCmdBeginRenderPass(commandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-            VkBuffer vertexBuffers[] = {vertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE);
-            // vkCmdDraw(commandBuffers[i], static_cast<uint32_t>(vertices.size()), 1, 0, 0);
-            vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
-            vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-            vkCmdEndRenderPass(commandBuffers[i]);
-            
-            vkCritical(vkEndCommandBuffer(commandBuffers[i]));
-        }
-    }
-
-    VkCommandBuffer beginOneTimeCommands() {
-        VkCommandBufferAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateInfo.commandPool = commandPool;
-        allocateInfo.commandBufferCount = 1;
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer);
+        for (auto& frame : frameCommands) {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = frame.commandPool;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandBufferCount = 1;
+            vkCritical(vkAllocateCommandBuffers(device, &allocateInfo, &frame.commandBuffer));
+        }
+    }
+
+    // Records the draw list of this frame into its (freshly reset) command buffer, optionally through secondaries recorded in parallel
+    void recordCommandBuffer(size_t frame, uint32_t imageIndex) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        VkCommandBuffer commandBuffer = frameCommands[frame].commandBuffer;
+        bool parallel = options.recordThreads > 0;
+
+        std::vector<VkCommandBuffer> secondaryBuffers;
+        if (parallel) {
+            uint32_t jobCount = static_cast<uint32_t>(std::min<size_t>(jobs.getWorkerCount(), drawList.size()));
+            size_t drawsPerJob = (drawList.size() + jobCount - 1) / std::max(jobCount, 1u);
+            secondaryBuffers.resize(jobCount);
+
+            jobs.dispatch(jobCount, [&](uint32_t job, uint32_t worker) {
+                VkCommandBuffer secondaryBuffer = acquireSecondaryBuffer(frame, worker);
+
+                VkCommandBufferInheritanceInfo inheritanceInfo{};
+                inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+                inheritanceInfo.renderPass = renderPass;
+                inheritanceInfo.subpass = 0;
+                inheritanceInfo.framebuffer = swapchainFramebuffers[imageIndex];
+
+                VkCommandBufferBeginInfo commandBufferBeginInfo{};
+                commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+                vkCritical(vkBeginCommandBuffer(secondaryBuffer, &commandBufferBeginInfo));
+                size_t begin = job * drawsPerJob;
+                recordDraws(secondaryBuffer, frame, begin, std::min(begin + drawsPerJob, drawList.size()));
+                vkCritical(vkEndCommandBuffer(secondaryBuffer));
+
+                secondaryBuffers[job] = secondaryBuffer;
+            });
+        }
+
+        VkCommandBufferBeginInfo commandBufferBeginInfo{};
+        commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        commandBufferBeginInfo.pInheritanceInfo = nullptr; // optional
+        vkCritical(vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo));
+        profiler.beginFrame(commandBuffer, frame);
+        recordMipGenerations(commandBuffer);
+        if (gpuCulling) {
+            recordCulling(commandBuffer, frame);
+        }
+        uint32_t renderPassScope = profiler.beginScope(commandBuffer, frame, "render pass");
+
+        VkRenderPassBeginInfo renderPassBeginInfo{};
+        renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassBeginInfo.renderPass = renderPass;
+        renderPassBeginInfo.framebuffer = swapchainFramebuffers[imageIndex];
+        renderPassBeginInfo.renderArea.offset = {0, 0};
+        renderPassBeginInfo.renderArea.extent = swapchainImageExtent;
+        VkClearValue clearColor = {1.0f, 1.0f, 1.0f, 1.0f};
+        renderPassBeginInfo.clearValueCount = 1;
+        renderPassBeginInfo.pClearValues = &clearColor;
+
+        if (parallel) {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            if (!secondaryBuffers.empty()) {
+                vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+            }
+        } else {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(commandBuffer, frame, 0, drawList.size());
+        }
+        vkCmdEndRenderPass(commandBuffer);
+        profiler.endScope(commandBuffer, frame, renderPassScope);
 
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-        return commandBuffer;
+        vkCritical(vkEndCommandBuffer(commandBuffer));
+
+        recordTimeTotal += std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        recordedFrames++;
     }
 
-    void endOneTimeCommands(VkCommandBuffer commandBuffer) {
-        vkEndCommandBuffer(commandBuffer);
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
+    // Secondaries inherit nothing but the render pass, so every command buffer binds its own state
+    void recordDraws(VkCommandBuffer commandBuffer, size_t frame, size_t begin, size_t end) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(swapchainImageExtent.width);
+        viewport.height = static_cast<float>(swapchainImageExtent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        VkRect2D scissor{};
+        scissor.offset = {0, 0};
+        scissor.extent = swapchainImageExtent;
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        VkBuffer vertexBuffers[] = {vertexBuffer, instanceBuffer};
+        VkDeviceSize offsets[] = {0, instanceOffset(frame)};
+        vkCmdBindVertexBuffers(commandBuffer, 0, options.instanced ? 2 : 1, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+        // The camera (and the bindless textures and materials) are bound once; draws only push their constants
+        uint32_t dynamicOffset = static_cast<uint32_t>(uniformOffset(frame));
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 1, &dynamicOffset);
+        if (bindless) {
+            VkDescriptorSet bindlessSet = bindlessTable.getSet();
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &bindlessSet, 0, nullptr);
+        }
+        for (size_t i = begin; i < end; i++) {
+            const DrawItem& item = drawList[i];
+            DrawConstants constants{};
+            // Instanced draws take their transforms from the instance buffer
+            constants.model = options.instanced ? glm::mat4(1.0f) : drawModels[i];
+            constants.objectIndex = item.object;
+            constants.materialIndex = bindless ? bindlessTable.getMaterialBase(frame) : 0;
+            vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+            if (gpuCulling) {
+                if (cmdDrawIndexedIndirectCount != nullptr) {
+                    cmdDrawIndexedIndirectCount(commandBuffer, indirectBuffer, indirectOffset(frame), indirectBuffer, drawCountOffset(frame), item.instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+                } else {
+                    vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, indirectOffset(frame), item.instanceCount, sizeof(VkDrawIndexedIndirectCommand));
+                }
+                continue;
+            }
+            vkCmdDrawIndexed(commandBuffer, item.indexCount, item.instanceCount, item.firstIndex, item.vertexOffset, item.firstInstance);
+        }
+    }
 
-        vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(graphicsQueue);
-        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+    // Called with the device idle: drops everything measured so far (warm-up frames, startup)
+    void resetMeasurements() {
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            profiler.collectFrame(i);
+        }
+        profiler.resetTotals();
+        recordTimeTotal = 0.0;
+        recordedFrames = 0;
+        lastFrameStart.reset();
+    }
+
+    // Machine-readable summary of a headless run
+    void writeReport(uint64_t frameCount, float timeElapsed) {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        std::string deviceName;
+        for (const char* c = deviceProperties.deviceName; *c != '\0'; c++) {
+            if (*c == '"' || *c == '\\') {
+                deviceName += '\\';
+            }
+            deviceName += *c;
+        }
+        double uploadMilliseconds = profiler.getUploadMilliseconds();
+        double uploadThroughput = uploadMilliseconds > 0.0 ? profiler.getUploadBytes() / 1073741824.0 / (uploadMilliseconds / 1000.0) : 0.0;
+
+        FILE* file = options.reportPath == "-" ? stdout : fopen(options.reportPath.c_str(), "w");
+        if (file == nullptr) {
+            throw std::runtime_error("Failed to open the report file " + options.reportPath + "\n");
+        }
+        fprintf(file, "{\"device\": \"%s\", \"frames\": %llu, \"warmup_frames\": %llu, \"objects\": %u, \"visible\": %s, \"draws\": %zu, \"instanced\": %s, \"gpu_culling\": %s, \"bindless\": %s, \"vertex_format\": \"%s\", \"pacing\": \"%s\", \"frames_in_flight\": %u, \"record_threads\": %u, \"timestep\": %.6f, "
+            "\"seconds\": %.6f, \"fps\": %.3f, \"cpu_ms_per_frame\": %.6f, \"record_ms_per_frame\": %.6f, \"gpu_ms_per_frame\": %.6f, \"input_latency_ms\": %.6f, "
+            "\"upload_bytes\": %llu, \"upload_gpu_ms\": %.6f, \"upload_gib_per_s\": %.3f}\n",
+            deviceName.c_str(), static_cast<unsigned long long>(frameCount), static_cast<unsigned long long>(options.warmupFrames), sceneObjectCount, gpuCulling ? "null" : std::to_string(visibleObjectCount).c_str(), drawList.size(), options.instanced ? "true" : "false", gpuCulling ? "true" : "false", bindless ? "true" : "false", vertexFormatName(vertexFormat), pacingModeName(options.pacing), framesInFlight, options.recordThreads, options.fixedTimestep,
+            timeElapsed, frameCount / timeElapsed, profiler.getMean("cpu frame"), recordedFrames > 0 ? recordTimeTotal / recordedFrames : 0.0, profiler.getMean("render pass"), profiler.getMean("input latency"),
+            static_cast<unsigned long long>(profiler.getUploadBytes()), uploadMilliseconds, uploadThroughput);
+        if (file != stdout) {
+            fclose(file);
+            LOG("Report written to %s\n", options.reportPath.c_str());
+        }
+    }
+
+    void logRecordingStats() {
+        if (recordedFrames == 0) {
+            return;
+        }
+        LOG("Command Recording: %.3f ms/frame over %llu frames (%u objects in %zu draws, %s)\n", recordTimeTotal / recordedFrames, static_cast<unsigned long long>(recordedFrames), sceneObjectCount, drawList.size(),
+            options.recordThreads > 0 ? (std::to_string(jobs.getWorkerCount()) + " threads, secondary buffers").c_str() : "inline");
     }
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-        // LOG("Max Memory Allocation Count: %u", maxMemoryAllocationCount);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkBuffer& buffer, Allocation& bufferMemory) {
         VkBufferCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         createInfo.size = size;
         createInfo.usage = bufferUsageFlags;
         createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // Upload destinations are written on the transfer queue and read on the graphics queue
+        uint32_t queueFamilies[] = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.transferFamily.value()};
+        if ((bufferUsageFlags & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && queueFamilyIndices.hasDedicatedTransfer()) {
+            createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices = queueFamilies;
+        }
 
         vkCritical(vkCreateBuffer(device, &createInfo, nullptr, &buffer));
 
         VkMemoryRequirements memoryRequirements;
         vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
 
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = selectMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        vkCritical(vkAllocateMemory(device, &allocateInfo, nullptr, &bufferMemory));
+        bufferMemory = allocator.allocate(memoryRequirements, memoryPropertyFlags, true);
+        vkCritical(vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset));
+    }
 
-        vkCritical(vkBindBufferMemory(device, buffer, bufferMemory, 0));
+    void createVertexBuffer() {
+        VkDeviceSize bufferSize = vertexData.size();
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, memoryVertexBuffer);
+        transfer.uploadBuffer(vertexData.data(), bufferSize, vertexBuffer);
     }
 
-    uint32_t selectMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags flags) {
-        VkPhysicalDeviceMemoryProperties memoryProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    void createIndexBuffer() {
+        VkDeviceSize bufferSize = indexData.size();
+        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, memoryIndexBuffer);
+        transfer.uploadBuffer(indexData.data(), bufferSize, indexBuffer);
+    }
 
-        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && ((memoryProperties.memoryTypes[i].propertyFlags & flags) == flags)) {
-                return i;
+    // The built-in quad, or the OBJ file given with --mesh; either goes through the same reordering (see mesh.hpp)
+    void loadMesh() {
+        auto start = std::chrono::high_resolution_clock::now();
+        Mesh mesh;
+        std::string name = options.meshPath.empty() ? "built-in quad" : options.meshPath;
+        if (options.meshPath.empty()) {
+            mesh.vertices = {
+                {{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {0.0f, 0.0f}},
+                {{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 0.0f}},
+                {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1.0f, 1.0f}},
+                {{-0.5f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}}
+            };
+            mesh.indices = {2, 1, 0, 0, 3, 2};
+        } else {
+            Asset asset;
+            std::string error;
+            if (!loadAsset(options.meshPath, asset, assetStats, true)) {
+                throw std::runtime_error("Failed to open the mesh " + options.meshPath + "\n");
             }
+            if (!loadObj(asset.data, asset.size, mesh, error)) {
+                throw std::runtime_error("Failed to load the mesh " + options.meshPath + ": " + error + "\n");
+            }
+            normalizeMesh(mesh);
         }
 
-        throw std::runtime_error("Failed to find suitable memory type!\n");
+        VertexCacheStats before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+        optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        optimizeVertexFetch(mesh);
+        VertexCacheStats after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+        // Without fullDrawIndexUint32 only indices up to 2^24 - 1 are guaranteed to work
+        if (mesh.vertices.size() > (1u << 24) && !supportedFeatures.fullDrawIndexUint32) {
+            throw std::runtime_error("The mesh " + name + " has more vertices than the device can index\n");
+        }
+        vertexFormat = options.vertexFormat;
+        if (vertexFormat != VertexFormat::Float && !isMeshQuantizable(mesh)) {
+            LOG("The mesh %s has attributes outside the range of the %s vertex layout, using float\n", name.c_str(), vertexFormatName(vertexFormat));
+            vertexFormat = VertexFormat::Float;
+        }
+        withVertexLayout(vertexFormat, [&](auto layout) {
+            using Layout = decltype(layout);
+            vertexStride = Layout::STRIDE;
+            vertexAttributeDescriptions = Layout::ATTRIBUTES;
+            vertexData = Layout::pack(mesh.vertices);
+        });
+        vertexCount = mesh.vertices.size();
+        meshBoundingRadius = 0.0f;
+        for (const auto& vertex : mesh.vertices) {
+            meshBoundingRadius = std::max(meshBoundingRadius, glm::length(vertex.position));
+        }
+        indexCount = static_cast<uint32_t>(mesh.indices.size());
+        if (mesh.vertices.size() <= UINT16_MAX + 1) {
+            indexType = VK_INDEX_TYPE_UINT16;
+            indexData.resize(mesh.indices.size() * sizeof(uint16_t));
+            uint16_t* indices16 = reinterpret_cast<uint16_t*>(indexData.data());
+            for (size_t i = 0; i < mesh.indices.size(); i++) {
+                indices16[i] = static_cast<uint16_t>(mesh.indices[i]);
+            }
+        } else {
+            indexType = VK_INDEX_TYPE_UINT32;
+            indexData.resize(mesh.indices.size() * sizeof(uint32_t));
+            memcpy(indexData.data(), mesh.indices.data(), indexData.size());
+        }
+
+        float timeElapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+        LOG("Mesh %s: %zu vertices (%s, %u bytes each), %u triangles, %s indices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, loaded in %.3f ms\n", name.c_str(),
+            vertexCount, vertexFormatName(vertexFormat), vertexStride, indexCount / 3, indexType == VK_INDEX_TYPE_UINT16 ? "16-bit" : "32-bit", before.acmr,
+            after.acmr, before.atvr, after.atvr, timeElapsed);
     }
 
-    void copyBufferToBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = beginOneTimeCommands();
-        
-        VkBufferCopy copyRegion{};
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+    // Centered and scaled to the unit square the built-in quad spans, so any mesh fits the object grid
+    static void normalizeMesh(Mesh& mesh) {
+        glm::vec3 minimum = mesh.vertices[0].position, maximum = mesh.vertices[0].position;
+        for (const auto& vertex : mesh.vertices) {
+            for (int axis = 0; axis < 3; axis++) {
+                minimum[axis] = std::min(minimum[axis], vertex.position[axis]);
+                maximum[axis] = std::max(maximum[axis], vertex.position[axis]);
+            }
+        }
+        float extent = std::max(maximum.x - minimum.x, std::max(maximum.y - minimum.y, maximum.z - minimum.z));
+        float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+        for (auto& vertex : mesh.vertices) {
+            for (int axis = 0; axis < 3; axis++) {
+                vertex.position[axis] = (vertex.position[axis] - (minimum[axis] + maximum[axis]) * 0.5f) * scale;
+            }
+        }
+    }
 
-        endOneTimeCommands(commandBuffer);
+    void createUniformBuffers() {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        VkDeviceSize alignment = deviceProperties.limits.minUniformBufferOffsetAlignment;
+        uniformSlotSize = (sizeof(CameraUniforms) + alignment - 1) / alignment * alignment;
+
+        createBuffer(uniformSlotSize * MAX_FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, memoryUniformBuffer);
     }
 
-    void createVertexBuffer() {
-        VkBuffer stagingBuffer;
-        VkDeviceMemory memoryStagingBuffer;
-        VkDeviceSize bufferSize = sizeof(Vertex) * vertices.size();
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, memoryStagingBuffer);
-        
-        void* data;
-        vkMapMemory(device, memoryStagingBuffer, 0, bufferSize, 0, &data);
-        memcpy(data, vertices.data(), (size_t) bufferSize);
-        vkUnmapMemory(device, memoryStagingBuffer);
-        
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, memoryVertexBuffer);
+    // Dynamic offset of the camera slot owned by a frame in flight
+    VkDeviceSize uniformOffset(size_t frame) {
+        return frame * uniformSlotSize;
+    }
 
-        copyBufferToBuffer(stagingBuffer, vertexBuffer, bufferSize);
-        
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, memoryStagingBuffer, nullptr);
+    // Written by the CPU through the mapping, or by the culling pass on the GPU
+    void createInstanceBuffer() {
+        if (gpuCulling) {
+            createBuffer(instanceOffset(MAX_FRAMES_IN_FLIGHT), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, memoryInstanceBuffer);
+        } else {
+            createBuffer(instanceOffset(MAX_FRAMES_IN_FLIGHT), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, instanceBuffer, memoryInstanceBuffer);
+        }
     }
 
-    void createIndexBuffer() {
-        VkDeviceSize bufferSize = sizeof(Index_t) * indices.size();
-        VkBuffer stagingBuffer;
-        VkDeviceMemory memoryStagingBuffer;
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, memoryStagingBuffer);
-        
-        void* data;
-        vkMapMemory(device, memoryStagingBuffer, 0, bufferSize, 0, &data);
-        memcpy(data, indices.data(), (size_t)bufferSize);
-        vkUnmapMemory(device, memoryStagingBuffer);
+    // Start of the instance region owned by a frame in flight
+    VkDeviceSize instanceOffset(size_t frame) {
+        return frame * MAX_INSTANCES * sizeof(InstanceData);
+    }
 
-        createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, memoryIndexBuffer);
+    VkDeviceSize indirectOffset(size_t frame) {
+        return frame * MAX_INSTANCES * sizeof(VkDrawIndexedIndirectCommand);
+    }
 
-        copyBufferToBuffer(stagingBuffer, indexBuffer, bufferSize);
+    VkDeviceSize drawCountOffset(size_t frame) {
+        return indirectOffset(MAX_FRAMES_IN_FLIGHT) + frame * drawCountStride;
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, memoryStagingBuffer, nullptr);
+    // Object placements are static, so they go up once with the startup batch; only the angle changes per frame
+    void createCullingResources() {
+        layoutSceneObjects(getSceneObjectCapacity());
+        std::vector<glm::vec4> placements(sceneObjectCount);
+        for (uint32_t i = 0; i < sceneObjectCount; i++) {
+            placements[i] = glm::vec4(sceneObjects.x[i], sceneObjects.y[i], sceneObjects.z[i], sceneObjects.scale[i]);
+        }
+        VkDeviceSize placementSize = sizeof(glm::vec4) * placements.size();
+        createBuffer(placementSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, objectBuffer, memoryObjectBuffer);
+        transfer.uploadBuffer(placements.data(), placementSize, objectBuffer);
+        // The draw counts are cleared with vkCmdFillBuffer
+        createBuffer(drawCountOffset(MAX_FRAMES_IN_FLIGHT), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indirectBuffer, memoryIndirectBuffer);
+
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+        for (uint32_t binding = 0; binding < bindings.size(); binding++) {
+            bindings[binding].binding = binding;
+            bindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[binding].descriptorCount = 1;
+            bindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+        VkDescriptorSetLayoutCreateInfo layoutCreateInfo{};
+        layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutCreateInfo.pBindings = bindings.data();
+        vkCritical(vkCreateDescriptorSetLayout(device, &layoutCreateInfo, nullptr, &cullDescriptorSetLayout));
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(CullConstants);
+        VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
+        pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutCreateInfo.setLayoutCount = 1;
+        pipelineLayoutCreateInfo.pSetLayouts = &cullDescriptorSetLayout;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        vkCritical(vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &cullPipelineLayout));
+
+        VkShaderModule shaderModule;
+        createShaderModule("build/cull.spv", shaderModule);
+        VkComputePipelineCreateInfo pipelineCreateInfo{};
+        pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineCreateInfo.stage.module = shaderModule;
+        pipelineCreateInfo.stage.pName = "main";
+        pipelineCreateInfo.layout = cullPipelineLayout;
+        vkCritical(vkCreateComputePipelines(device, pipelineCache.handle(), 1, &pipelineCreateInfo, nullptr, &cullPipeline));
+        vkDestroyShaderModule(device, shaderModule, nullptr);
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = static_cast<uint32_t>(bindings.size() * MAX_FRAMES_IN_FLIGHT);
+        VkDescriptorPoolCreateInfo poolCreateInfo{};
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolCreateInfo.poolSizeCount = 1;
+        poolCreateInfo.pPoolSizes = &poolSize;
+        poolCreateInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
+        vkCritical(vkCreateDescriptorPool(device, &poolCreateInfo, nullptr, &cullDescriptorPool));
+
+        // A set per frame in flight, each pointing at the regions that frame owns
+        for (size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; frame++) {
+            VkDescriptorSetAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            allocateInfo.descriptorPool = cullDescriptorPool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &cullDescriptorSetLayout;
+            vkCritical(vkAllocateDescriptorSets(device, &allocateInfo, &cullDescriptorSets[frame]));
+
+            std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+            bufferInfos[0] = {objectBuffer, 0, placementSize};
+            bufferInfos[1] = {instanceBuffer, instanceOffset(frame), MAX_INSTANCES * sizeof(InstanceData)};
+            bufferInfos[2] = {indirectBuffer, indirectOffset(frame), MAX_INSTANCES * sizeof(VkDrawIndexedIndirectCommand)};
+            bufferInfos[3] = {indirectBuffer, drawCountOffset(frame), sizeof(uint32_t)};
+            std::array<VkWriteDescriptorSet, 4> descriptorSetWrites{};
+            for (uint32_t binding = 0; binding < descriptorSetWrites.size(); binding++) {
+                descriptorSetWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorSetWrites[binding].dstSet = cullDescriptorSets[frame];
+                descriptorSetWrites[binding].dstBinding = binding;
+                descriptorSetWrites[binding].dstArrayElement = 0;
+                descriptorSetWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorSetWrites[binding].descriptorCount = 1;
+                descriptorSetWrites[binding].pBufferInfo = &bufferInfos[binding];
+            }
+            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorSetWrites.size()), descriptorSetWrites.data(), 0, nullptr);
+        }
     }
 
-    void createUniformBuffers() {
-        VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-        uniformBuffers.resize(swapchainImages.size());
-        memoryUniformBuffers.resize(swapchainImages.size());
-        for (size_t i = 0; i < swapchainImages.size(); i++) {
-            createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], memoryUniformBuffers[i]);
+    // Recorded before the render pass: clear the count, cull, then make the commands and transforms visible to the draw
+    void recordCulling(VkCommandBuffer commandBuffer, size_t frame) {
+        uint32_t cullingScope = profiler.beginScope(commandBuffer, frame, "culling");
+        CullConstants constants{};
+        extractFrustumPlanes(cameraProjection * cameraView, constants.frustumPlanes);
+        constants.angle = sceneAngle;
+        constants.boundingRadius = meshBoundingRadius;
+        constants.objectCount = sceneObjectCount;
+        constants.indexCount = indexCount;
+        constants.compact = cmdDrawIndexedIndirectCount != nullptr ? 1 : 0;
+
+        if (constants.compact) {
+            vkCmdFillBuffer(commandBuffer, indirectBuffer, drawCountOffset(frame), sizeof(uint32_t), 0);
+            VkMemoryBarrier clearBarrier{};
+            clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
         }
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSets[frame], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, (sceneObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+        VkMemoryBarrier cullBarrier{};
+        cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+        profiler.endScope(commandBuffer, frame, cullingScope);
     }
 
     void createDescriptorSetLayout() {
         VkDescriptorSetLayoutBinding uboLayoutBinding{};
         uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         uboLayoutBinding.descriptorCount = 1;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr; // Optional
@@ -1109,102 +2011,419 @@ private:
         samplerLayoutBinding.pImmutableSamplers = nullptr;
         samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+        // The bindless path samples from set 1 instead
         std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
         VkDescriptorSetLayoutCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        createInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        createInfo.bindingCount = bindless ? 1 : static_cast<uint32_t>(bindings.size());
         createInfo.pBindings = bindings.data();
         vkCritical(vkCreateDescriptorSetLayout(device, &createInfo, nullptr, &descriptorSetLayout));
     }
 
     void createDescriptorPool() {
         std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(swapchainImages.size());
+        // The set in use plus the ones replaced by texture streaming that frames in flight may still read
+        uint32_t maxSets = 2 + MAX_FRAMES_IN_FLIGHT;
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[0].descriptorCount = maxSets;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(swapchainImages.size());
+        poolSizes[1].descriptorCount = maxSets;
         
         VkDescriptorPoolCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        createInfo.poolSizeCount = bindless ? 1 : static_cast<uint32_t>(poolSizes.size());
         createInfo.pPoolSizes = poolSizes.data();
-        createInfo.maxSets = static_cast<uint32_t>(swapchainImages.size());
+        createInfo.maxSets = maxSets;
 
         vkCritical(vkCreateDescriptorPool(device, &createInfo, nullptr, &descriptorPool));
     }
 
     void createDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(swapchainImages.size(), descriptorSetLayout);
+        createDescriptorSet(descriptorSet, textureImageView);
+        if (bindless) {
+            createBindlessMaterials();
+        }
+    }
+
+    // The objects cycle through a palette of tinted materials, all sampling the one texture
+    void createBindlessMaterials() {
+        bindlessTable.setSampler(textureSampler);
+        textureSlot = bindlessTable.addTexture(textureImageView);
+        // The first material leaves the texture as it is
+        const glm::vec4 tints[BINDLESS_MATERIAL_PALETTE_SIZE] = {
+            {1.0f, 1.0f, 1.0f, 1.0f}, {1.0f, 0.6f, 0.6f, 1.0f}, {0.6f, 1.0f, 0.6f, 1.0f}, {0.6f, 0.6f, 1.0f, 1.0f},
+            {1.0f, 1.0f, 0.6f, 1.0f}, {0.6f, 1.0f, 1.0f, 1.0f}, {1.0f, 0.6f, 1.0f, 1.0f}, {0.8f, 0.8f, 0.8f, 1.0f},
+        };
+        for (uint32_t i = 0; i < BINDLESS_MATERIAL_PALETTE_SIZE; i++) {
+            BindlessMaterial material{};
+            material.tint = tints[i];
+            material.textureIndex = textureSlot;
+            bindlessTable.addMaterial(material);
+        }
+    }
+
+    void createDescriptorSet(VkDescriptorSet& descriptorSet, VkImageView textureImageView) {
         VkDescriptorSetAllocateInfo allocateInfo{};
         allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocateInfo.descriptorPool = descriptorPool;
-        allocateInfo.descriptorSetCount = static_cast<uint32_t>(swapchainImages.size());
-        allocateInfo.pSetLayouts = layouts.data();
+        allocateInfo.descriptorSetCount = 1;
+        allocateInfo.pSetLayouts = &descriptorSetLayout;
+        vkCritical(vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSet));
+
+        // The offset of the slot in use is supplied at bind time (dynamic offset)
+        VkDescriptorBufferInfo descriptorBufferInfo{};
+        descriptorBufferInfo.buffer = uniformBuffer;
+        descriptorBufferInfo.offset = 0;
+        descriptorBufferInfo.range = sizeof(CameraUniforms);
+
+        VkDescriptorImageInfo descriptorImageInfo{};
+        descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        descriptorImageInfo.imageView = textureImageView;
+        descriptorImageInfo.sampler = textureSampler;
+        
+        std::array<VkWriteDescriptorSet, 2> descriptorSetWrites{};
+        descriptorSetWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorSetWrites[0].dstSet = descriptorSet;
+        descriptorSetWrites[0].dstBinding = 0;
+        descriptorSetWrites[0].dstArrayElement = 0;
+        descriptorSetWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        descriptorSetWrites[0].descriptorCount = 1;
+        descriptorSetWrites[0].pBufferInfo = &descriptorBufferInfo;
+
+        descriptorSetWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorSetWrites[1].dstSet = descriptorSet;
+        descriptorSetWrites[1].dstBinding = 1;
+        descriptorSetWrites[1].dstArrayElement = 0;
+        descriptorSetWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorSetWrites[1].descriptorCount = 1;
+        descriptorSetWrites[1].pImageInfo = &descriptorImageInfo;
+        
+        vkUpdateDescriptorSets(device, bindless ? 1 : static_cast<uint32_t>(descriptorSetWrites.size()), descriptorSetWrites.data(), 0, nullptr);
+    }
 
-        descriptorSets.resize(swapchainImages.size());
-        vkCritical(vkAllocateDescriptorSets(device, &allocateInfo, descriptorSets.data()));
+    // Bound until the real texture is resident, so the first frames render without waiting on the decode
+    void createPlaceholderTexture() {
+        const uint8_t pixels[2 * 2 * 4] = {
+            128, 128, 128, 255,   96,  96,  96, 255,
+             96,  96,  96, 255,  128, 128, 128, 255,
+        };
+        createImage(2, 2, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, placeholderImage, memoryPlaceholderImage);
+        transfer.uploadImage(pixels, sizeof(pixels), placeholderImage, 2, 2);
+        createImageView(placeholderImageView, placeholderImage, VK_FORMAT_R8G8B8A8_SRGB);
+        textureImageView = placeholderImageView;
+    }
 
-        for (size_t i = 0; i < swapchainImages.size(); i++) {
-            VkDescriptorBufferInfo descriptorBufferInfo{};
-            descriptorBufferInfo.buffer = uniformBuffers[i];
-            descriptorBufferInfo.offset = 0;
-            descriptorBufferInfo.range = sizeof(UniformBufferObject);
-
-            VkDescriptorImageInfo descriptorImageInfo{};
-            descriptorImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            descriptorImageInfo.imageView = textureImageView;
-            descriptorImageInfo.sampler = textureSampler;
-            
-            std::array<VkWriteDescriptorSet, 2> descriptorSetWrites{};
-            descriptorSetWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorSetWrites[0].dstSet = descriptorSets[i];
-            descriptorSetWrites[0].dstBinding = 0;
-            descriptorSetWrites[0].dstArrayElement = 0;
-            descriptorSetWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorSetWrites[0].descriptorCount = 1;
-            descriptorSetWrites[0].pBufferInfo = &descriptorBufferInfo;
-
-            descriptorSetWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorSetWrites[1].dstSet = descriptorSets[i];
-            descriptorSetWrites[1].dstBinding = 1;
-            descriptorSetWrites[1].dstArrayElement = 0;
-            descriptorSetWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorSetWrites[1].descriptorCount = 1;
-            descriptorSetWrites[1].pImageInfo = &descriptorImageInfo;
-            
-            vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorSetWrites.size()), descriptorSetWrites.data(), 0, nullptr);
-        } 
+    // Decoding runs on decodeQueue; the result is picked up by collectDecodedTextures() at the start of a later frame
+    void requestTextureLoad() {
+        textureRequestTime = std::chrono::high_resolution_clock::now();
+        decodeQueue.push([this] {
+            DecodedTexture texture = decodeTexture();
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            decodedTextures.push_back(std::move(texture));
+        });
+    }
+
+    // Worker thread: everything up to the Vulkan calls. The cooked texture when there is one (see cook.cpp), otherwise the
+    // source image decoded here.
+    DecodedTexture decodeTexture() const {
+        auto start = std::chrono::high_resolution_clock::now();
+        DecodedTexture texture;
+        CookedTextureView cooked;
+        if (loadAsset(COOKED_TEXTURE_PATH, texture.source, texture.stats) && parseCookedTexture(texture.source.data, texture.source.size, cooked)) {
+            decodeCookedTexture(cooked, texture);
+        } else {
+            texture.source = Asset{};
+            LOG("Texture: no cooked texture at %s, decoding %s\n", COOKED_TEXTURE_PATH, SOURCE_TEXTURE_PATH);
+            decodeSourceTexture(texture);
+        }
+        texture.milliseconds = std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count();
+        texture.stats.addTime(texture.milliseconds);
+        return texture;
+    }
+
+    void decodeCookedTexture(const CookedTextureView& cooked, DecodedTexture& texture) const {
+        VkFormat format;
+        switch (cooked.format) {
+            case TextureFormat::BC1: format = cooked.srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK; break;
+            case TextureFormat::BC3: format = cooked.srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK; break;
+            default: format = cooked.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM; break;
+        }
+
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        VkFormatFeatureFlags sampleFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        bool supported = (formatProperties.optimalTilingFeatures & sampleFeatures) == sampleFeatures
+            && (cooked.format == TextureFormat::RGBA8 || supportedFeatures.textureCompressionBC);
+        texture.mipLevels = static_cast<uint32_t>(cooked.levels.size());
+
+        // Supported formats go from the asset straight into staging memory; the asset lives as long as levels are pending
+        if (supported) {
+            texture.format = format;
+            texture.levels = cooked.levels;
+            texture.data = cooked.data;
+            texture.description = std::string("cooked as ") + textureFormatName(cooked.format);
+            return;
+        }
+        texture.chain = decompressMipChain(cooked.levels, cooked.data, cooked.format);
+        texture.stats.addCopy(texture.chain.data.size());
+        texture.source = Asset{};
+        texture.format = cooked.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        texture.levels = texture.chain.levels;
+        texture.data = texture.chain.data.data();
+        texture.description = std::string("cooked as ") + textureFormatName(cooked.format) + ", decompressed (not supported by the device)";
     }
 
-    void createTextureImage() {
+    void decodeSourceTexture(DecodedTexture& texture) const {
+        Asset asset;
+        if (!loadAsset(SOURCE_TEXTURE_PATH, asset, texture.stats, true)) {
+            texture.error = "Failed to load texture image!";
+            return;
+        }
         int imageWidth, imageHeight, imageChannels;
-        stbi_uc* pixels = stbi_load("textures/texture.jpg", &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
+        stbi_uc* pixels = stbi_load_from_memory(asset.data, static_cast<int>(asset.size), &imageWidth, &imageHeight, &imageChannels, STBI_rgb_alpha);
         if (!pixels) {
-            throw std::runtime_error("Failed to load texture image!");
+            texture.error = "Failed to load texture image!";
+            return;
+        }
+        uint32_t width = static_cast<uint32_t>(imageWidth), height = static_cast<uint32_t>(imageHeight);
+        size_t imageSize = static_cast<size_t>(width) * height * IMAGE_CHANNEL_COUNT;
+        texture.stats.addCopy(imageSize);
+        texture.format = VK_FORMAT_R8G8B8A8_SRGB;
+        texture.mipLevels = mipLevelCount(width, height);
+
+        // Blitting needs a graphics queue and a format that can be linearly filtered; otherwise the chain is built on the CPU
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
+        VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        texture.generateMipmaps = !options.streamTextures && (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+
+        if (texture.generateMipmaps) {
+            texture.chain.levels.push_back({width, height, 0, imageSize});
+            texture.chain.data.assign(pixels, pixels + imageSize);
+            texture.description = "mip levels generated on the GPU";
+        } else {
+            texture.chain = buildMipChain(pixels, width, height, true);
+            texture.description = "mip levels generated on the CPU";
         }
-        VkDeviceSize imageSize = imageWidth * imageHeight * IMAGE_CHANNEL_COUNT;
-        
-        VkBuffer stagingBuffer;
-        VkDeviceMemory memoryStagingBuffer;
-        createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, memoryStagingBuffer);
-        
-        void* data;
-        vkMapMemory(device, memoryStagingBuffer, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize)); vkUnmapMemory(device, memoryStagingBuffer);
-        
         stbi_image_free(pixels);
+        texture.stats.addCopy(texture.chain.data.size());
+        texture.levels = texture.chain.levels;
+        texture.data = texture.chain.data.data();
+    }
 
-        createImage(imageWidth, imageHeight, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, memoryTextureImage);
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(imageWidth), static_cast<uint32_t>(imageHeight));
-        transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Main thread, once per frame: hands finished decodes to the transfer path
+    void collectDecodedTextures() {
+        std::vector<DecodedTexture> decoded;
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            decoded.swap(decodedTextures);
+        }
+        for (auto& texture : decoded) {
+            if (!texture.error.empty()) {
+                throw std::runtime_error(texture.error);
+            }
+            assetStats.merge(texture.stats);
+            createTextureImage(std::move(texture));
+        }
+    }
+
+    void createTextureImage(DecodedTexture&& texture) {
+        textureFormat = texture.format;
+        textureMipLevels = texture.mipLevels;
+        const MipLevel& base = texture.levels[0];
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (texture.generateMipmaps ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+        createImage(base.width, base.height, textureMipLevels, textureFormat, VK_IMAGE_TILING_OPTIMAL, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, memoryTextureImage);
+        LOG("Texture: %u x %u, %u mip levels, %s, decoded in %.1f ms on a worker\n", base.width, base.height, textureMipLevels, texture.description.c_str(), texture.milliseconds);
+
+        // Nothing is sampled from the image until its first levels are published by streamTextures()
+        textureStream.source = std::move(texture.source);
+        textureStream.chain = std::move(texture.chain);
+        textureStream.levels = std::move(texture.levels);
+        textureStream.data = texture.data;
+        textureStream.residentLevel = textureMipLevels;
+        textureStream.active = true;
+
+        if (texture.generateMipmaps) {
+            const MipLevel& mip = textureStream.levels[0];
+            transfer.uploadImage(textureStream.data, mip.size, textureImage, mip.width, mip.height, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+            assetStats.addCopy(mip.size);
+            pendingMipGenerations.push_back({textureImage, mip.width, mip.height, textureMipLevels, transfer.getOpenTicket()});
+            textureStream.pendingLevel = 0;
+        } else {
+            textureStream.pendingLevel = uploadTextureChain();
+        }
+        textureStream.pendingTicket = transfer.submit();
+        if (textureStream.pendingLevel == 0) {
+            releaseTextureSource();
+        }
+    }
+
+    // Every level of the chain in textureStream, or only the coarse ones when streaming; returns the first level uploaded
+    uint32_t uploadTextureChain() {
+        uint32_t firstLevel = 0;
+        if (options.streamTextures) {
+            // Start with the levels that fit in TEXTURE_STREAM_COARSE_SIZE; the finer ones follow one per frame
+            while (firstLevel + 1 < textureMipLevels && std::max(textureStream.levels[firstLevel].width, textureStream.levels[firstLevel].height) > TEXTURE_STREAM_COARSE_SIZE) {
+                firstLevel++;
+            }
+        }
+        for (uint32_t level = firstLevel; level < textureMipLevels; level++) {
+            uploadTextureLevel(textureStream.levels[level], textureStream.data, level);
+        }
+        return firstLevel;
+    }
 
-        vkDestroyBuffer(device, stagingBuffer, nullptr);
-        vkFreeMemory(device, memoryStagingBuffer, nullptr);
+    void uploadTextureLevel(const MipLevel& mip, const uint8_t* data, uint32_t level) {
+        transfer.uploadImage(data + mip.offset, mip.size, textureImage, mip.width, mip.height, level);
+        assetStats.addCopy(mip.size);
+    }
+
+    // Staging copies are made when a level is recorded, so the source can go as soon as the last level has been
+    void releaseTextureSource() {
+        textureStream.source = Asset{};
+        textureStream.chain = MipChain{};
+        textureStream.levels.clear();
+        textureStream.data = nullptr;
     }
 
     void createTextureImageView() {
-        createImageView(textureImageView, textureImage, VK_FORMAT_R8G8B8A8_SRGB);
+        uint32_t baseMipLevel = textureStream.residentLevel;
+        createImageView(textureImageView, textureImage, textureFormat, baseMipLevel, textureMipLevels - baseMipLevel);
+    }
+
+    // Each level is blitted from the previous one, which is then handed to the fragment shader
+    void recordMipGenerations(VkCommandBuffer commandBuffer) {
+        for (auto it = pendingMipGenerations.begin(); it != pendingMipGenerations.end();) {
+            if (it->ticket > transfer.getSubmittedTicket()) {
+                ++it;
+                continue;
+            }
+
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = it->image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.levelCount = 1;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+
+            int32_t width = static_cast<int32_t>(it->width), height = static_cast<int32_t>(it->height);
+            for (uint32_t level = 1; level < it->mipLevels; level++) {
+                barrier.subresourceRange.baseMipLevel = level;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+                VkImageBlit blit{};
+                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.srcSubresource.mipLevel = level - 1;
+                blit.srcSubresource.baseArrayLayer = 0;
+                blit.srcSubresource.layerCount = 1;
+                blit.srcOffsets[0] = {0, 0, 0};
+                blit.srcOffsets[1] = {width, height, 1};
+                width = std::max(width / 2, 1);
+                height = std::max(height / 2, 1);
+                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.dstSubresource.mipLevel = level;
+                blit.dstSubresource.baseArrayLayer = 0;
+                blit.dstSubresource.layerCount = 1;
+                blit.dstOffsets[0] = {0, 0, 0};
+                blit.dstOffsets[1] = {width, height, 1};
+                vkCmdBlitImage(commandBuffer, it->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, it->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+                // level - 1 is final; level becomes the source of the next blit
+                barrier.subresourceRange.baseMipLevel = level - 1;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+                barrier.subresourceRange.baseMipLevel = level;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+            }
+
+            barrier.subresourceRange.baseMipLevel = it->mipLevels - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            it = pendingMipGenerations.erase(it);
+        }
+    }
+
+    // Once per frame: publish the levels that finished uploading (replacing the placeholder the first time), then send the
+    // next finer one
+    void streamTextures() {
+        if (!textureStream.active) {
+            return;
+        }
+
+        if (textureStream.pendingTicket != 0) {
+            if (!transfer.isComplete(textureStream.pendingTicket)) {
+                return;
+            }
+            // Descriptor sets in use by frames in flight must not be updated, so the new view gets a new set, or a new slot of the
+            // bindless array; the old view and set (or slot) go once the frames recorded so far have completed. The first swap
+            // also retires the placeholder.
+            VkImageView oldImageView = textureImageView;
+            bool firstLevels = textureStream.residentLevel == textureMipLevels;
+            textureStream.residentLevel = textureStream.pendingLevel;
+            textureStream.pendingTicket = 0;
+            createTextureImageView();
+            if (bindless) {
+                uint32_t oldSlot = textureSlot;
+                textureSlot = bindlessTable.addTexture(textureImageView);
+                bindlessTable.replaceTexture(oldSlot, textureSlot);
+                deletionQueue.push(frameNumber, [this, oldImageView, oldSlot]() {
+                    vkDestroyImageView(device, oldImageView, nullptr);
+                    bindlessTable.removeTexture(oldSlot);
+                });
+            } else {
+                VkDescriptorSet oldDescriptorSet = descriptorSet;
+                createDescriptorSet(descriptorSet, textureImageView);
+                deletionQueue.push(frameNumber, [this, oldImageView, oldDescriptorSet]() {
+                    vkDestroyImageView(device, oldImageView, nullptr);
+                    vkCritical(vkFreeDescriptorSets(device, descriptorPool, 1, &oldDescriptorSet));
+                });
+            }
+            if (placeholderImageView != VK_NULL_HANDLE) {
+                deletionQueue.push(frameNumber, [this, image = placeholderImage, memory = memoryPlaceholderImage]() mutable {
+                    vkDestroyImage(device, image, nullptr);
+                    allocator.free(memory);
+                });
+                placeholderImageView = VK_NULL_HANDLE;
+                placeholderImage = VK_NULL_HANDLE;
+                memoryPlaceholderImage = {};
+            }
+            float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - textureRequestTime).count();
+            if (textureStream.residentLevel == 0) {
+                textureStream.active = false;
+                releaseTextureSource();
+                LOG("Texture: resident after %llu frames, %.1f ms after it was requested\n", static_cast<unsigned long long>(frameNumber), milliseconds);
+                assetStats.report();
+                return;
+            }
+            if (firstLevels) {
+                LOG("Texture: levels %u+ resident after %llu frames, %.1f ms after it was requested; streaming the rest\n", textureStream.residentLevel, static_cast<unsigned long long>(frameNumber), milliseconds);
+            }
+        }
+
+        uint32_t level = textureStream.residentLevel - 1;
+        uploadTextureLevel(textureStream.levels[level], textureStream.data, level);
+        textureStream.pendingLevel = level;
+        textureStream.pendingTicket = transfer.submit();
     }
 
     void createTextureSampler() {
@@ -1219,8 +2438,10 @@ private:
         createInfo.anisotropyEnable = VK_FALSE;
         createInfo.maxAnisotropy = 1;
         #endif
-        createInfo.anisotropyEnable = VK_TRUE;
-        createInfo.maxAnisotropy = 16;
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        createInfo.anisotropyEnable = supportedFeatures.samplerAnisotropy;
+        createInfo.maxAnisotropy = supportedFeatures.samplerAnisotropy ? std::min(16.0f, deviceProperties.limits.maxSamplerAnisotropy) : 1.0f;
         createInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
         createInfo.unnormalizedCoordinates = VK_FALSE;
         createInfo.compareEnable = VK_FALSE;
@@ -1228,18 +2449,18 @@ private:
         createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         createInfo.mipLodBias = 0.0f;
         createInfo.minLod = 0.0f;
-        createInfo.maxLod = 0.0f;
+        createInfo.maxLod = VK_LOD_CLAMP_NONE;
         vkCritical(vkCreateSampler(device, &createInfo, nullptr, &textureSampler));
     }
 
-    void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& memory) {
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, Allocation& memory) {
         VkImageCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         createInfo.imageType = VK_IMAGE_TYPE_2D;
         createInfo.extent.width = width;
         createInfo.extent.height = height;
         createInfo.extent.depth = 1;
-        createInfo.mipLevels = 1;
+        createInfo.mipLevels = mipLevels;
         createInfo.arrayLayers = 1;
         createInfo.format = format;
         createInfo.tiling = tiling;
@@ -1247,141 +2468,187 @@ private:
         createInfo.usage = usage;
         createInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        uint32_t queueFamilies[] = {queueFamilyIndices.graphicsFamily.value(), queueFamilyIndices.transferFamily.value()};
+        if ((usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) && queueFamilyIndices.hasDedicatedTransfer()) {
+            createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = 2;
+            createInfo.pQueueFamilyIndices = queueFamilies;
+        }
         vkCritical(vkCreateImage(device, &createInfo, nullptr, &image));
 
         VkMemoryRequirements memoryRequirements;
         vkGetImageMemoryRequirements(device, image, &memoryRequirements);
-        VkMemoryAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocateInfo.allocationSize = memoryRequirements.size;
-        allocateInfo.memoryTypeIndex = selectMemoryType(memoryRequirements.memoryTypeBits, properties);
-        vkCritical(vkAllocateMemory(device, &allocateInfo, nullptr, &memory));
-
-        vkBindImageMemory(device, image, memory, 0);
-    }
-
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-        VkCommandBuffer commandBuffer = beginOneTimeCommands();
-
-        VkImageMemoryBarrier imageMemoryBarrier{};
-        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        imageMemoryBarrier.oldLayout = oldLayout;
-        imageMemoryBarrier.newLayout = newLayout;
-        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        imageMemoryBarrier.image = image;
-        imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        imageMemoryBarrier.subresourceRange.baseMipLevel = 0;
-        imageMemoryBarrier.subresourceRange.levelCount = 1;
-        imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
-        imageMemoryBarrier.subresourceRange.layerCount = 1;
-
-        VkPipelineStageFlags srcStage;
-        VkPipelineStageFlags dstStage;
-        if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            imageMemoryBarrier.srcAccessMask = 0;
-            imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            dstStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        } else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            imageMemoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-            srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        } else {
-            throw std::invalid_argument("unsupported layout transition!");
-        }
-
-        vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
-
-        endOneTimeCommands(commandBuffer);
-    }
-
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-        VkCommandBuffer commandBuffer = beginOneTimeCommands();
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {width, height, 1};
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-        endOneTimeCommands(commandBuffer);
+        memory = allocator.allocate(memoryRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR);
+        vkCritical(vkBindImageMemory(device, image, memory.memory, memory.offset));
     }
 
     void mainLoop() {
+        float maxFps = options.maxFps > 0.0f ? options.maxFps : options.pacing == PacingMode::PowerSaving ? POWER_SAVING_MAX_FPS : 0.0f;
+        frameLimiter.setMaxFps(maxFps);
+        LOG("Pacing: %s, %u frames in flight, frame limit %.1f fps (0 is none)\n", pacingModeName(options.pacing), framesInFlight, maxFps);
+        if (options.headless) {
+            uint64_t frameCount = options.frameCount > 0 ? options.frameCount : DEFAULT_HEADLESS_FRAME_COUNT;
+            for (uint64_t i = 0; i < options.warmupFrames; i++) {
+                pollFrameInput();
+                renderFrame();
+            }
+            vkDeviceWaitIdle(device);
+            resetMeasurements();
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            for (uint64_t i = 0; i < frameCount; i++) {
+                pollFrameInput();
+                renderFrame();
+            }
+            vkDeviceWaitIdle(device);
+            float timeElapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+            for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+                profiler.collectFrame(i);
+            }
+            LOG("Headless: %llu frames in %.3f s (%.1f fps)\n", static_cast<unsigned long long>(frameCount), timeElapsed, frameCount / timeElapsed);
+            logRecordingStats();
+            profiler.report();
+            if (!options.reportPath.empty()) {
+                writeReport(frameCount, timeElapsed);
+            }
+            return;
+        }
+
+        uint64_t framesRendered = 0;
         while (!glfwWindowShouldClose(window)) {
-            glfwPollEvents();
+            pollFrameInput();
             renderFrame();
+            if (options.frameCount > 0 && ++framesRendered >= options.frameCount) {
+                break;
+            }
         }
         vkDeviceWaitIdle(device);
+        logRecordingStats();
+        profiler.report();
+    }
+
+    // Frame limit first, then the wait for a free frame slot, and only then input: whatever blocks happens before the input
+    // is sampled, so it is as fresh as possible when the frame is recorded. Headless runs have no events to poll.
+    void pollFrameInput() {
+        frameLimiter.wait();
+        waitForFrameSlot();
+        inputSampleTime = std::chrono::high_resolution_clock::now();
+        if (!options.headless) {
+            glfwPollEvents();
+        }
+    }
+
+    // The next frame reuses the slot of frame frameNumber + 1 - framesInFlight, the only wait on the CPU
+    void waitForFrameSlot() {
+        if (frameNumber + 1 > framesInFlight) {
+            frameTimeline.wait(frameNumber + 1 - framesInFlight);
+        }
+    }
+
+    void addInputLatencySample() {
+        profiler.addCpuTime("input latency", std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - inputSampleTime).count());
     }
 
     void renderFrame() {
         static uint64_t frameCount = 0;
+        if (frameCount == 0) {
+            LOG("Startup: first frame after %.1f ms\n", std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - startTime).count());
+        }
+        auto frameStart = std::chrono::high_resolution_clock::now();
+        if (lastFrameStart.has_value()) {
+            profiler.addCpuFrameTime(std::chrono::duration<double, std::chrono::milliseconds::period>(frameStart - lastFrameStart.value()).count());
+        }
+        lastFrameStart = frameStart;
         if (frameCount++ % 90 == 0) {
             LOG(WHITE "Render Frame-%05llu\n" CLEAR, frameCount-1);
+            if (frameCount > 1) {
+                profiler.report();
+            }
         }
 
         VkResult result;
 
-        vkCritical(vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max()));
+        // Returns at once after pollFrameInput()
+        waitForFrameSlot();
+        profiler.collectFrame(currentFrame);
+        transfer.poll();
+        deletionQueue.collect(frameTimeline.getCompletedValue());
+        resetCommandPools(currentFrame);
+        collectDecodedTextures();
+        streamTextures();
+
+        std::vector<VkSemaphore> waitSemaphores;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
 
         uint32_t imageIndex;
+        if (options.headless) {
+            // Offscreen targets map one-to-one onto frames in flight; nothing to acquire or present
+            imageIndex = static_cast<uint32_t>(currentFrame);
+            updateScene();
+            updateUniformBuffer(currentFrame);
+            if (options.instanced && !gpuCulling) {
+                updateInstanceBuffer(currentFrame);
+            }
+            if (bindless) {
+                bindlessTable.updateMaterials(currentFrame);
+            }
+            recordCommandBuffer(currentFrame, imageIndex);
+
+            submitFrame(waitSemaphores, waitValues, waitStages, VK_NULL_HANDLE);
+            addInputLatencySample();
+
+            currentFrame = (currentFrame + 1) % framesInFlight;
+            return;
+        }
         result = vkAcquireNextImageKHR(device, swapchain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
             LOG("Swapchain Out Of Date\n");        
             refreshSwapchain();
             framebufferResized = false;
             return;
         }
-        if (result != VK_SUCCESS) {
+        // A suboptimal image is still acquired (and its semaphore signaled); draw it and refresh after presenting
+        bool suboptimal = result == VK_SUBOPTIMAL_KHR;
+        if (result != VK_SUCCESS && !suboptimal) {
             throw std::runtime_error("Failed to acquire the swapchain image!\n");
         } 
 
-        updateUniformBuffer(imageIndex);
-
-        // check if a previous frame is using this image (i.e. there is its fence to wait on)
-        if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
-            vkCritical(vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max()));
+        updateScene();
+        updateUniformBuffer(currentFrame);
+        if (options.instanced && !gpuCulling) {
+            updateInstanceBuffer(currentFrame);
         }
-
-        // mark the image as now being in use by this frame
-        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
-        
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
-        VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        vkCritical(vkResetFences(device, 1, &inFlightFences[currentFrame]));
-        vkCritical(vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]));
+        if (bindless) {
+            bindlessTable.updateMaterials(currentFrame);
+        }
+        recordCommandBuffer(currentFrame, imageIndex);
+
+        // No wait for a previous frame rendering to this image: it was presented before it could be acquired again, and
+        // acquiring it orders this frame's color output after that present through the semaphore
+        waitSemaphores.push_back(imageAvailableSemaphores[currentFrame]);
+        waitValues.push_back(0); // binary, ignored
+        waitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+        VkSemaphore renderFinished = renderFinishedSemaphores[imageIndex];
+        submitFrame(waitSemaphores, waitValues, waitStages, renderFinished);
         
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinished;
         VkSwapchainKHR swapchains[] = {swapchain};
         presentInfo.swapchainCount = 1;
         presentInfo.pSwapchains = swapchains;
         presentInfo.pImageIndices = &imageIndex;
         presentInfo.pResults = nullptr; // optional
 
+        // Measured up to the call: a FIFO present may block inside it until an image is released
+        addInputLatencySample();
         // vkCritical(vkQueuePresentKHR(presentQueue, &presentInfo));
         result = vkQueuePresentKHR(presentQueue, &presentInfo);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
+        // The frame has been submitted either way, so its slot is used up
+        currentFrame = (currentFrame + 1) % framesInFlight;
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || suboptimal || framebufferResized) {
             refreshSwapchain();
             framebufferResized = false;
             return;
@@ -1391,58 +2658,266 @@ private:
         }
 
         // vkCritical(vkQueueWaitIdle(presentQueue));
+    }
 
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    // Signals frameNumber + 1 on the frame timeline, and `renderFinished` (binary, for the present) unless it is null
+    void submitFrame(std::vector<VkSemaphore>& waitSemaphores, std::vector<uint64_t>& waitValues, std::vector<VkPipelineStageFlags>& waitStages, VkSemaphore renderFinished) {
+        transfer.takeWait(waitSemaphores, waitValues, waitStages);
+
+        std::vector<VkSemaphore> signalSemaphores = {frameTimeline.get()};
+        std::vector<uint64_t> signalValues = {frameNumber + 1};
+        if (renderFinished != VK_NULL_HANDLE) {
+            signalSemaphores.push_back(renderFinished);
+            signalValues.push_back(0); // binary, ignored
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+        timelineSubmitInfo.pWaitSemaphoreValues = waitValues.data();
+        timelineSubmitInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineSubmitInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &frameCommands[currentFrame].commandBuffer;
+        submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        submitInfo.pSignalSemaphores = signalSemaphores.data();
+        vkCritical(vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE));
+        frameNumber++;
     }
 
     void createSemaphores() {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 
         VkSemaphoreCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
             vkCritical(vkCreateSemaphore(device, &createInfo, nullptr, &imageAvailableSemaphores[i]));
-            vkCritical(vkCreateSemaphore(device, &createInfo, nullptr, &renderFinishedSemaphores[i]));
         }
+        createRenderFinishedSemaphores();
     }
 
-    void createFences() {
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-
-        VkFenceCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // fences are initially signaled
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            vkCritical(vkCreateFence(device, &createInfo, nullptr, &inFlightFences[i]));
+    // One per swapchain image. Acquiring an image again means its previous present has consumed the wait, so in steady state
+    // none is signaled while a present still waits on it; refreshSwapchain() retires the set with the old swapchain.
+    void createRenderFinishedSemaphores() {
+        if (options.headless) {
+            return;
+        }
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        while (renderFinishedSemaphores.size() < swapchainImages.size()) {
+            VkSemaphore semaphore;
+            vkCritical(vkCreateSemaphore(device, &createInfo, nullptr, &semaphore));
+            renderFinishedSemaphores.push_back(semaphore);
         }
+    }
 
-        imagesInFlight.resize(swapchainImages.size(), VK_NULL_HANDLE);
+    void updateCamera() {
+        cameraView = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+        cameraProjection = glm::perspective(glm::radians(45.0f), swapchainImageExtent.width / (float) swapchainImageExtent.height, 0.1f, 10.0f);
+        cameraProjection[1][1] *= -1;
+        cameraVersion++;
+        cameraDirty = false;
     }
 
-    void updateUniformBuffer(uint32_t currentImage) {
+    // Objects are laid out on a grid in the z = 0 plane, all spinning around their own z axis
+    void updateScene() {
         static auto startTime = std::chrono::high_resolution_clock::now();
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float timeElapsed = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        float timeElapsed;
+        if (options.fixedTimestep > 0.0f) {
+            // Deterministic: the scene depends only on the frame number
+            timeElapsed = frameNumber * options.fixedTimestep;
+        } else {
+            timeElapsed = std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+        }
+
+        uint32_t objectCount = getSceneObjectCapacity();
+        if (objectCount != sceneObjectCount) {
+            layoutSceneObjects(objectCount);
+        }
+        // Wrapped, so the angle keeps its precision on long runs
+        sceneAngle = std::fmod(timeElapsed * glm::radians(90.0f), glm::radians(360.0f));
+
+        // A single draw for every object; their transforms are written by updateInstanceBuffer() or the culling pass
+        if (options.instanced) {
+            drawList.resize(1);
+            drawList[0] = {0, indexCount, 0, 0, objectCount, 0};
+        }
+        if (!gpuCulling) {
+            std::fill(sceneObjects.angle.begin(), sceneObjects.angle.end(), sceneAngle);
+        }
+    }
+
+    uint32_t getSceneObjectCapacity() const {
+        return std::min(options.objectCount, MAX_INSTANCES);
+    }
+
+    void layoutSceneObjects(uint32_t objectCount) {
+        uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(objectCount))));
+        float spacing = 1.0f / gridSize;
+        sceneObjects.x.resize(objectCount);
+        sceneObjects.y.resize(objectCount);
+        sceneObjects.z.assign(objectCount, 0.0f);
+        sceneObjects.angle.assign(objectCount, 0.0f);
+        sceneObjects.scale.assign(objectCount, spacing);
+        sceneObjects.radius.assign(objectCount, meshBoundingRadius);
+        for (uint32_t i = 0; i < objectCount; i++) {
+            sceneObjects.x[i] = (i % gridSize + 0.5f) * spacing - 0.5f;
+            sceneObjects.y[i] = (i / gridSize + 0.5f) * spacing - 0.5f;
+        }
+        sceneObjectCount = objectCount;
+    }
+
+    // Culled on the CPU: only visible objects get a transform, packed, so the instance count drops with them. The bindless
+    // path also needs to know whose transform each instance is, to keep the object's material.
+    void updateInstanceBuffer(size_t frame) {
+        auto instances = reinterpret_cast<InstanceData*>(static_cast<uint8_t*>(memoryInstanceBuffer.mapped) + instanceOffset(frame));
+        if (bindless) {
+            visibilityMask.resize((sceneObjectCount + 31) / 32);
+        }
+        TransformBatchOutput output{reinterpret_cast<uint8_t*>(instances), sizeof(InstanceData), bindless ? visibilityMask.data() : nullptr};
+        visibleObjectCount = transformSceneObjects(output);
+        drawList[0].instanceCount = visibleObjectCount;
+        if (bindless) {
+            uint32_t instance = 0;
+            for (uint32_t object = 0; object < sceneObjectCount; object++) {
+                if (visibilityMask[object / 32] & (1u << (object % 32))) {
+                    instances[instance++].object = object;
+                }
+            }
+        }
+    }
 
-        UniformBufferObject ubo{};
-        ubo.model = glm::rotate(glm::mat4(1.0f), timeElapsed * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.projection = glm::perspective(glm::radians(45.0f), swapchainImageExtent.width / (float) swapchainImageExtent.height, 0.1f, 10.0f);
-        ubo.projection[1][1] *= -1;
+    // Model matrices and frustum culling of every object in one call of the batched kernel
+    uint32_t transformSceneObjects(const TransformBatchOutput& output) {
+        TransformBatchInput input{sceneObjects.x.data(), sceneObjects.y.data(), sceneObjects.z.data(), sceneObjects.angle.data(), sceneObjects.scale.data(),
+            sceneObjects.radius.data(), sceneObjectCount};
+        glm::vec4 planes[6];
+        extractFrustumPlanes(cameraProjection * cameraView, planes);
+        return transformBatch(transformKernel, input, planes, output);
+    }
+
+    // The region of this frame is no longer read by the GPU once waitForFrameSlot() has returned
+    void updateUniformBuffer(size_t frame) {
+        if (cameraDirty) {
+            updateCamera();
+        }
+
+        // One draw per visible object: the kernel writes their model matrices in draw order, the mask says whose they are
+        if (!options.instanced) {
+            drawModels.resize(sceneObjectCount);
+            visibilityMask.resize((sceneObjectCount + 31) / 32);
+            TransformBatchOutput output{reinterpret_cast<uint8_t*>(drawModels.data()), sizeof(glm::mat4), visibilityMask.data()};
+            visibleObjectCount = transformSceneObjects(output);
+            drawList.resize(visibleObjectCount);
+            uint32_t draw = 0;
+            for (uint32_t object = 0; object < sceneObjectCount; object++) {
+                if (visibilityMask[object / 32] & (1u << (object % 32))) {
+                    drawList[draw++] = {object, indexCount, 0, 0, 1, 0};
+                }
+            }
+        }
 
-        void* data;
-        vkMapMemory(device, memoryUniformBuffers[currentImage], 0, sizeof(UniformBufferObject), 0, &data);
-        memcpy(data, &ubo, sizeof(UniformBufferObject));
-        vkUnmapMemory(device, memoryUniformBuffers[currentImage]);
+        if (uniformRegionCameraVersion[frame] != cameraVersion) {
+            auto camera = reinterpret_cast<CameraUniforms*>(static_cast<char*>(memoryUniformBuffer.mapped) + uniformOffset(frame));
+            camera->view = cameraView;
+            camera->projection = cameraProjection;
+            uniformRegionCameraVersion[frame] = cameraVersion;
+        }
     }
 };
 /********************************************************************************************************************************/
 
 /********************************************************************************************************************************/
-int main()
+bool parseOptions(int argc, char** argv, AppOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frameCount = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--objects" && i + 1 < argc) {
+            options.objectCount = static_cast<uint32_t>(std::max(1ul, std::strtoul(argv[++i], nullptr, 10)));
+        } else if (arg == "--record-threads" && i + 1 < argc) {
+            options.recordThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--timestep" && i + 1 < argc) {
+            options.fixedTimestep = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            options.warmupFrames = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--report" && i + 1 < argc) {
+            options.reportPath = argv[++i];
+        } else if (arg == "--stream-textures") {
+            options.streamTextures = true;
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            options.meshPath = argv[++i];
+        } else if (arg == "--vertex-format" && i + 1 < argc) {
+            std::string format = argv[++i];
+            if (format == "float") {
+                options.vertexFormat = VertexFormat::Float;
+            } else if (format == "half") {
+                options.vertexFormat = VertexFormat::Half;
+            } else if (format == "snorm16") {
+                options.vertexFormat = VertexFormat::Snorm16;
+            } else {
+                LOG("Unknown vertex format: %s (float, half or snorm16)\n", format.c_str());
+                return false;
+            }
+        } else if (arg == "--instanced") {
+            options.instanced = true;
+        } else if (arg == "--gpu-culling") {
+            options.instanced = true;
+            options.gpuCulling = true;
+        } else if (arg == "--bindless") {
+            options.bindless = true;
+        } else if (arg == "--pacing" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "latency") {
+                options.pacing = PacingMode::Latency;
+            } else if (mode == "throughput") {
+                options.pacing = PacingMode::Throughput;
+            } else if (mode == "power") {
+                options.pacing = PacingMode::PowerSaving;
+            } else {
+                LOG("Unknown pacing mode: %s (latency, throughput or power)\n", mode.c_str());
+                return false;
+            }
+        } else if (arg == "--frames-in-flight" && i + 1 < argc) {
+            options.framesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--max-fps" && i + 1 < argc) {
+            options.maxFps = std::strtof(argv[++i], nullptr);
+        } else if (arg == "--decode-threads" && i + 1 < argc) {
+            options.decodeThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            LOG("Unknown option: %s\n", arg.c_str());
+            LOG(WHITE "Usage: %s [--headless] [--frames N] [--objects N] [--record-threads N] [--timestep SECONDS] [--warmup N] [--report PATH|-] [--mesh PATH] [--vertex-format float|half|snorm16] [--stream-textures] [--decode-threads N] [--instanced] [--gpu-culling] [--bindless] [--pacing latency|throughput|power] [--frames-in-flight N] [--max-fps N]\n" CLEAR, argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
 {
-    HelloVulkan app;
+    AppOptions options;
+#if defined(BENCHMARK)
+    // bench.app: offscreen, fixed frame count, simulated time and a JSON report, unless overridden
+    options.headless = true;
+    options.frameCount = BENCHMARK_FRAME_COUNT;
+    options.warmupFrames = BENCHMARK_WARMUP_FRAMES;
+    options.fixedTimestep = BENCHMARK_TIMESTEP;
+    options.reportPath = "build/bench.json";
+#endif
+    if (!parseOptions(argc, argv, options)) {
+        return EXIT_FAILURE;
+    }
+
+    HelloVulkan app(options);
 
     try {
         app.run();
@@ -1,6 +1,11 @@
 #if !defined(MAIN)
 #define MAIN
 
+#include <cstdio>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
 #define BLACK "\x1b[38;5;0m"
 #define RED "\x1b[38;5;1m"
 #define GREEN "\x1b[38;5;2m"
@@ -19,6 +24,62 @@
 const bool ENABLE_VALIDATION_LAYER = false;
 const bool ENABLE_DEBUG_MESSENGER = true;
 
-const uint64_t MAX_FRAMES_IN_FLIGHT = 2;
+// Per-frame resources are allocated for MAX_FRAMES_IN_FLIGHT; the pacing mode decides how many are used (see frame_pacing.hpp)
+const uint64_t MAX_FRAMES_IN_FLIGHT = 3;
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+// CPU frame limit of the power saving pacing mode, unless --max-fps is given
+const float POWER_SAVING_MAX_FPS = 30.0f;
+const uint64_t DEFAULT_HEADLESS_FRAME_COUNT = 1000;
+
+// Transforms per frame in flight in the instance ring (--instanced), and the object limit of every path
+const uint32_t MAX_INSTANCES = 65536;
+
+// Bindless mode (--bindless): slots of the sampled image array (lowered to the device limit), materials per frame in flight,
+// and the number of materials the objects cycle through
+const uint32_t BINDLESS_MAX_TEXTURES = 4096;
+const uint32_t BINDLESS_MAX_MATERIALS = 1024;
+const uint32_t BINDLESS_MATERIAL_PALETTE_SIZE = 8;
+
+// Device memory is reserved in blocks of this size per memory type and sub-allocated from there
+const uint64_t ALLOCATOR_BLOCK_SIZE = 64 * 1024 * 1024;
+
+// Upload batches grow their staging memory in chunks of this size
+const uint64_t TRANSFER_STAGING_CHUNK_SIZE = 8 * 1024 * 1024;
+
+// Pipeline cache blob, kept next to the compiled shaders
+const char* const PIPELINE_CACHE_PATH = "build/pipeline.cache";
+
+// Timestamp scopes per frame in flight, and how many samples per scope the rolling statistics cover
+const uint32_t PROFILER_SCOPES_PER_FRAME = 16;
+const size_t PROFILER_WINDOW = 90;
+
+// Defaults of the benchmark build (bench.app): measured frames, unmeasured warm-up frames, simulated seconds per frame
+const uint64_t BENCHMARK_FRAME_COUNT = 2000;
+const uint64_t BENCHMARK_WARMUP_FRAMES = 100;
+const float BENCHMARK_TIMESTEP = 1.0f / 60.0f;
+
+// Archive written by pack.app; assets missing from it (or all of them, without one) are read from loose files
+const char* const ASSET_PACK_PATH = "build/assets.pack";
+
+// The texture as written by cook.app, and the image it is cooked from, decoded at startup when there is no cooked file
+const char* const COOKED_TEXTURE_PATH = "textures/texture.lvtex";
+const char* const SOURCE_TEXTURE_PATH = "textures/texture.jpg";
+
+// Streamed textures start out with the mip levels no larger than this
+const uint32_t TEXTURE_STREAM_COARSE_SIZE = 64;
+
+#define vkCritical(result) if (result != VK_SUCCESS) { throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + ": Vulkan Failure\n"); }
+
+#if defined(ENABLE_LOGGING)
+#define LOG(...) printf(BRIGHT_RED); printf(__VA_ARGS__); printf(CLEAR);
+#else
+#define LOG(...)
+#endif
+
+#if defined(ENABLE_DEBUG_LOGGING)
+#define DLOG(...) printf(RED); printf(__VA_ARGS__); printf(CLEAR);
+#else
+#define DLOG(...)
+#endif
 
 #endif
\ No newline at end of file
@@ -0,0 +1,76 @@
+#if !defined(MIPMAPS)
+#define MIPMAPS
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/********************************************************************************************************************************/
+// CPU mip chain for RGBA8 images, used when the GPU cannot blit the format and for streaming, which needs every level up
+// front. Levels are tightly packed one after another, finest first.
+struct MipLevel {
+    uint32_t width;
+    uint32_t height;
+    size_t offset;
+    size_t size;
+};
+
+struct MipChain {
+    std::vector<MipLevel> levels;
+    std::vector<uint8_t> data;
+};
+
+inline uint32_t mipLevelCount(uint32_t width, uint32_t height) {
+    return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+// 2x2 box filter; sRGB color channels are averaged in linear space, alpha as is
+inline MipChain buildMipChain(const uint8_t* pixels, uint32_t width, uint32_t height, bool srgb) {
+    float toLinear[256];
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        toLinear[i] = !srgb ? c : (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f));
+    }
+    auto fromLinear = [srgb](float c) {
+        c = !srgb ? c : (c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f);
+        return static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, c * 255.0f + 0.5f)));
+    };
+
+    MipChain chain;
+    uint32_t levelCount = mipLevelCount(width, height);
+    size_t totalSize = 0;
+    for (uint32_t level = 0, w = width, h = height; level < levelCount; level++, w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+        chain.levels.push_back({w, h, totalSize, static_cast<size_t>(w) * h * 4});
+        totalSize += chain.levels.back().size;
+    }
+    chain.data.resize(totalSize);
+    std::copy(pixels, pixels + chain.levels[0].size, chain.data.begin());
+
+    for (uint32_t level = 1; level < levelCount; level++) {
+        const MipLevel& source = chain.levels[level - 1];
+        const MipLevel& destination = chain.levels[level];
+        const uint8_t* src = chain.data.data() + source.offset;
+        uint8_t* dst = chain.data.data() + destination.offset;
+        for (uint32_t y = 0; y < destination.height; y++) {
+            // Odd sizes: the last row/column is reused instead of reading past the edge
+            uint32_t y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+            for (uint32_t x = 0; x < destination.width; x++) {
+                uint32_t x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint8_t* texels[4] = {
+                    src + (static_cast<size_t>(y0) * source.width + x0) * 4, src + (static_cast<size_t>(y0) * source.width + x1) * 4,
+                    src + (static_cast<size_t>(y1) * source.width + x0) * 4, src + (static_cast<size_t>(y1) * source.width + x1) * 4
+                };
+                uint8_t* out = dst + (static_cast<size_t>(y) * destination.width + x) * 4;
+                for (int c = 0; c < 3; c++) {
+                    out[c] = fromLinear((toLinear[texels[0][c]] + toLinear[texels[1][c]] + toLinear[texels[2][c]] + toLinear[texels[3][c]]) * 0.25f);
+                }
+                out[3] = static_cast<uint8_t>((texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3] + 2) / 4);
+            }
+        }
+    }
+    return chain;
+}
+/********************************************************************************************************************************/
+
+#endif
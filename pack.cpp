@@ -0,0 +1,107 @@
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "main.hpp"
+#include "asset_io.hpp"
+#include "asset_pack.hpp"
+
+/********************************************************************************************************************************/
+// Asset packer: writes the given files into one .pack archive, each under the path it was given as, so the application
+// looks assets up by the same relative path it would otherwise open.
+//
+//     pack.app <output.pack> [--lz4] <file>...
+//
+// With --lz4 every entry is LZ4 compressed, unless that saves less than an eighth of its size; SPIR-V stays uncompressed
+// either way so shader modules can be created straight from the mapping.
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <output.pack> [--lz4] <file>...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    std::string outputPath = argv[1];
+    bool compress = false;
+    std::vector<std::string> inputPaths;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--lz4") == 0) {
+            compress = true;
+        } else {
+            inputPaths.push_back(argv[i]);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<PackEntry> entries(inputPaths.size());
+    std::string names;
+    for (size_t i = 0; i < inputPaths.size(); i++) {
+        entries[i].nameOffset = static_cast<uint32_t>(names.size());
+        entries[i].nameSize = static_cast<uint32_t>(inputPaths[i].size());
+        names += inputPaths[i];
+    }
+
+    PackHeader header{};
+    header.magic = PACK_MAGIC;
+    header.version = PACK_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.namesOffset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+    header.namesSize = names.size();
+
+    // Entry data is collected first, the index written once every offset is known
+    std::vector<uint8_t> data;
+    uint64_t dataOffset = (header.namesOffset + header.namesSize + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    uint64_t uncompressedTotal = 0;
+    for (size_t i = 0; i < inputPaths.size(); i++) {
+        MappedFile file;
+        if (!file.open(inputPaths[i], true)) {
+            fprintf(stderr, "Failed to read %s\n", inputPaths[i].c_str());
+            return EXIT_FAILURE;
+        }
+
+        PackEntry& entry = entries[i];
+        entry.type = assetTypeFromPath(inputPaths[i]);
+        entry.uncompressedSize = file.size();
+        data.resize((data.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT);
+        entry.offset = dataOffset + data.size();
+
+        std::vector<uint8_t> compressed;
+        if (compress && entry.type != AssetType::Spirv) {
+            compressed = lz4::compress(file.data(), file.size());
+        }
+        if (!compressed.empty() && compressed.size() < file.size() - file.size() / 8) {
+            entry.flags = PACK_ENTRY_LZ4;
+            entry.size = compressed.size();
+            data.insert(data.end(), compressed.begin(), compressed.end());
+        } else {
+            entry.size = file.size();
+            data.insert(data.end(), file.data(), file.data() + file.size());
+        }
+        uncompressedTotal += entry.uncompressedSize;
+        LOG("\t%-32s %10llu -> %10llu bytes%s\n", inputPaths[i].c_str(), static_cast<unsigned long long>(entry.uncompressedSize),
+            static_cast<unsigned long long>(entry.size), entry.flags & PACK_ENTRY_LZ4 ? " (lz4)" : "");
+    }
+
+    std::ofstream ofs(outputPath, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(PackEntry));
+    ofs.write(names.data(), names.size());
+    std::vector<char> padding(dataOffset - header.namesOffset - header.namesSize, 0);
+    ofs.write(padding.data(), padding.size());
+    ofs.write(reinterpret_cast<const char*>(data.data()), data.size());
+    if (!ofs.good()) {
+        fprintf(stderr, "Failed to write %s\n", outputPath.c_str());
+        return EXIT_FAILURE;
+    }
+
+    LOG("Packed %zu assets into %s: %.1f KiB from %.1f KiB in %.1f ms\n", entries.size(), outputPath.c_str(), (dataOffset + data.size()) / 1024.0,
+        uncompressedTotal / 1024.0, std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count());
+    return EXIT_SUCCESS;
+}
+/********************************************************************************************************************************/
@@ -0,0 +1,179 @@
+#if !defined(PIPELINE_CACHE)
+#define PIPELINE_CACHE
+
+#include <vulkan/vulkan.h>
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// VkPipelineCache persisted to disk. The blob is prefixed with our own header so a cache written by another GPU or driver
+// version is discarded up front instead of being handed to the driver.
+class PipelineCache
+{
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path) {
+        this->device = device;
+        this->path = path;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+        std::vector<uint8_t> initialData;
+        if (load(initialData)) {
+            LOG("Pipeline Cache: loaded %zu bytes from %s\n", initialData.size(), path.c_str());
+        } else {
+            initialData.clear();
+        }
+        warm = !initialData.empty();
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+        vkCritical(vkCreatePipelineCache(device, &createInfo, nullptr, &cache));
+    }
+
+    void destroy() {
+        save();
+        vkDestroyPipelineCache(device, cache, nullptr);
+    }
+
+    VkPipelineCache handle() const {
+        return cache;
+    }
+
+    // Warm once the cache was seeded from disk or has seen a pipeline in this run
+    bool isWarm() const {
+        return warm;
+    }
+
+    void markWarm() {
+        warm = true;
+    }
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t checksum;
+    };
+    static const uint32_t MAGIC = 0x4350564c; // "LVPC"
+    static const uint32_t VERSION = 1;
+
+    // The header Vulkan itself puts in front of VkPipelineCache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+    struct VulkanHeader {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties deviceProperties{};
+    std::string path;
+    bool warm = false;
+
+    static uint64_t checksum(const uint8_t* data, size_t size) {
+        // FNV-1a
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ data[i]) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool load(std::vector<uint8_t>& data) {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs.is_open()) {
+            return false;
+        }
+
+        FileHeader header{};
+        ifs.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (ifs.fail() || header.magic != MAGIC || header.version != VERSION) {
+            LOG("Pipeline Cache: %s is not a pipeline cache, ignoring\n", path.c_str());
+            return false;
+        }
+        if (header.vendorID != deviceProperties.vendorID || header.deviceID != deviceProperties.deviceID || header.driverVersion != deviceProperties.driverVersion
+            || memcmp(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            LOG("Pipeline Cache: %s was written by another device or driver, ignoring\n", path.c_str());
+            return false;
+        }
+
+        // The size comes from the file; a damaged header must not make us allocate more than the file holds
+        ifs.seekg(0, std::ios::end);
+        uint64_t payloadSize = static_cast<uint64_t>(ifs.tellg()) - sizeof(header);
+        ifs.seekg(sizeof(header), std::ios::beg);
+        if (ifs.fail() || header.dataSize > payloadSize) {
+            LOG("Pipeline Cache: %s is truncated or corrupt, ignoring\n", path.c_str());
+            return false;
+        }
+
+        data.resize(header.dataSize);
+        ifs.read(reinterpret_cast<char*>(data.data()), header.dataSize);
+        if (ifs.fail() || checksum(data.data(), data.size()) != header.checksum) {
+            LOG("Pipeline Cache: %s is truncated or corrupt, ignoring\n", path.c_str());
+            return false;
+        }
+
+        VulkanHeader vulkanHeader{};
+        if (data.size() < sizeof(vulkanHeader)) {
+            return false;
+        }
+        memcpy(&vulkanHeader, data.data(), sizeof(vulkanHeader));
+        return vulkanHeader.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && vulkanHeader.vendorID == deviceProperties.vendorID
+            && vulkanHeader.deviceID == deviceProperties.deviceID
+            && memcmp(vulkanHeader.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    // Written to a temporary file and renamed over the old one, so a crash never leaves a half-written cache behind
+    void save() {
+        size_t dataSize = 0;
+        vkCritical(vkGetPipelineCacheData(device, cache, &dataSize, nullptr));
+        std::vector<uint8_t> data(dataSize);
+        vkCritical(vkGetPipelineCacheData(device, cache, &dataSize, data.data()));
+        data.resize(dataSize);
+
+        FileHeader header{};
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.vendorID = deviceProperties.vendorID;
+        header.deviceID = deviceProperties.deviceID;
+        header.driverVersion = deviceProperties.driverVersion;
+        memcpy(header.pipelineCacheUUID, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.dataSize = data.size();
+        header.checksum = checksum(data.data(), data.size());
+
+        std::string temporaryPath = path + ".tmp";
+        FILE* file = fopen(temporaryPath.c_str(), "wb");
+        if (file == nullptr) {
+            LOG("Pipeline Cache: cannot write %s\n", temporaryPath.c_str());
+            return;
+        }
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data.data(), 1, data.size(), file) == data.size();
+        written = written && fflush(file) == 0 && fsync(fileno(file)) == 0;
+        fclose(file);
+        if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0) {
+            LOG("Pipeline Cache: failed to save %s\n", path.c_str());
+            unlink(temporaryPath.c_str());
+            return;
+        }
+        LOG("Pipeline Cache: saved %zu bytes to %s\n", data.size(), path.c_str());
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
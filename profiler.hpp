@@ -0,0 +1,274 @@
+#if !defined(PROFILER)
+#define PROFILER
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// GPU timings from timestamp queries. Frame scopes live in one query pool with a set of queries per frame in flight; a set
+// is read back right after the frame timeline shows that frame complete, so reading never stalls. Upload batches run on the
+// transfer queue at their own pace and get a small query pool each.
+class GpuProfiler
+{
+public:
+    void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t graphicsFamily, uint32_t transferFamily, PFN_vkResetQueryPoolEXT hostResetQueryPool) {
+        this->device = device;
+        this->hostResetQueryPool = hostResetQueryPool;
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        graphicsMask = validBitsMask(queueFamilies[graphicsFamily].timestampValidBits);
+        transferMask = validBitsMask(queueFamilies[transferFamily].timestampValidBits);
+        // vkCmdResetQueryPool is not available on transfer-only queues; those need a host-side reset instead
+        transferCommandReset = (queueFamilies[transferFamily].queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) != 0;
+        uploadTiming = transferMask != 0 && (transferCommandReset || hostResetQueryPool != nullptr);
+
+        if (graphicsMask != 0) {
+            VkQueryPoolCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            createInfo.queryCount = MAX_FRAMES_IN_FLIGHT * PROFILER_SCOPES_PER_FRAME * 2;
+            vkCritical(vkCreateQueryPool(device, &createInfo, nullptr, &frameQueryPool));
+        }
+
+        LOG("GPU Profiler: timestamp period %.3f ns, graphics %s, uploads %s\n", timestampPeriod, graphicsMask != 0 ? "timed" : "not timed (no timestamp support)",
+            uploadTiming ? "timed" : "not timed (no timestamp support or query reset on the transfer queue)");
+    }
+
+    void destroy() {
+        if (frameQueryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(device, frameQueryPool, nullptr);
+        }
+        for (auto queryPool : uploadQueryPools) {
+            vkDestroyQueryPool(device, queryPool, nullptr);
+        }
+    }
+
+    // Call once the previous frame in slot `frame` has completed: every query it wrote is available by now
+    void collectFrame(size_t frame) {
+        auto& scopes = frameScopes[frame];
+        if (scopes.empty()) {
+            return;
+        }
+
+        uint32_t firstQuery = static_cast<uint32_t>(frame * PROFILER_SCOPES_PER_FRAME * 2);
+        uint32_t queryCount = static_cast<uint32_t>(scopes.size() * 2);
+        // (timestamp, availability) pairs
+        std::vector<uint64_t> results(queryCount * 2);
+        VkResult result = vkGetQueryPoolResults(device, frameQueryPool, firstQuery, queryCount, results.size() * sizeof(uint64_t), results.data(),
+            2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY) {
+            vkCritical(result);
+        }
+
+        for (size_t i = 0; i < scopes.size(); i++) {
+            const uint64_t* begin = &results[i * 4];
+            const uint64_t* end = &results[i * 4 + 2];
+            if (begin[1] != 0 && end[1] != 0) {
+                addSample(scopes[i], toMilliseconds(begin[0], end[0], graphicsMask));
+            }
+        }
+        scopes.clear();
+    }
+
+    // Must be recorded outside of a render pass, before any scope of this frame
+    void beginFrame(VkCommandBuffer commandBuffer, size_t frame) {
+        if (frameQueryPool == VK_NULL_HANDLE) {
+            return;
+        }
+        vkCmdResetQueryPool(commandBuffer, frameQueryPool, static_cast<uint32_t>(frame * PROFILER_SCOPES_PER_FRAME * 2), PROFILER_SCOPES_PER_FRAME * 2);
+    }
+
+    // Returns a handle for endScope(); scopes with the same name are aggregated
+    uint32_t beginScope(VkCommandBuffer commandBuffer, size_t frame, const char* name) {
+        auto& scopes = frameScopes[frame];
+        if (frameQueryPool == VK_NULL_HANDLE || scopes.size() == PROFILER_SCOPES_PER_FRAME) {
+            return UINT32_MAX;
+        }
+        uint32_t scope = static_cast<uint32_t>(scopes.size());
+        scopes.push_back(findStats(name));
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frameQueryPool, frameQuery(frame, scope));
+        return scope;
+    }
+
+    void endScope(VkCommandBuffer commandBuffer, size_t frame, uint32_t scope) {
+        if (scope == UINT32_MAX) {
+            return;
+        }
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frameQueryPool, frameQuery(frame, scope) + 1);
+    }
+
+    // Upload batches: a two-query pool per batch, reused whenever the batch is recycled
+    VkQueryPool createUploadQueries() {
+        if (!uploadTiming) {
+            return VK_NULL_HANDLE;
+        }
+        VkQueryPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = 2;
+        VkQueryPool queryPool;
+        vkCritical(vkCreateQueryPool(device, &createInfo, nullptr, &queryPool));
+        uploadQueryPools.push_back(queryPool);
+        return queryPool;
+    }
+
+    // Right after vkBeginCommandBuffer of a batch; the batch's previous submission has completed
+    void beginUpload(VkCommandBuffer commandBuffer, VkQueryPool queryPool) {
+        if (queryPool == VK_NULL_HANDLE) {
+            return;
+        }
+        if (transferCommandReset) {
+            vkCmdResetQueryPool(commandBuffer, queryPool, 0, 2);
+        } else {
+            hostResetQueryPool(device, queryPool, 0, 2);
+        }
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, 0);
+    }
+
+    void endUpload(VkCommandBuffer commandBuffer, VkQueryPool queryPool) {
+        if (queryPool == VK_NULL_HANDLE) {
+            return;
+        }
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+    }
+
+    // After the batch's timeline value has been reached
+    void collectUpload(VkQueryPool queryPool, VkDeviceSize bytes) {
+        if (queryPool == VK_NULL_HANDLE) {
+            return;
+        }
+        uint64_t results[2];
+        if (vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(results), results, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return;
+        }
+        double milliseconds = toMilliseconds(results[0], results[1], transferMask);
+        addSample(findStats("upload batch"), milliseconds);
+        uploadBytes += bytes;
+        uploadMilliseconds += milliseconds;
+    }
+
+    void addCpuFrameTime(double milliseconds) {
+        addSample(findStats("cpu frame"), milliseconds);
+    }
+
+    // CPU-side intervals measured by the caller, reported next to the GPU scopes
+    void addCpuTime(const char* name, double milliseconds) {
+        addSample(findStats(name), milliseconds);
+    }
+
+    // Rolling min/avg/p99 over the last PROFILER_WINDOW samples of every scope
+    void report() {
+        LOG("Profiler (last %zu samples):\n", PROFILER_WINDOW);
+        for (auto& stats : scopeStats) {
+            if (stats.samples.empty()) {
+                continue;
+            }
+            std::vector<double> sorted = stats.samples;
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0.0;
+            for (double sample : sorted) {
+                sum += sample;
+            }
+            size_t p99 = std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99));
+            LOG(WHITE "\t%-14s min %8.3f  avg %8.3f  p99 %8.3f ms\n" CLEAR, stats.name.c_str(), sorted.front(), sum / sorted.size(), sorted[p99]);
+        }
+        if (uploadMilliseconds > 0.0) {
+            LOG(WHITE "\t%-14s %.1f MiB at %.2f GiB/s\n" CLEAR, "uploads", uploadBytes / 1048576.0, uploadBytes / 1073741824.0 / (uploadMilliseconds / 1000.0));
+        }
+    }
+
+    // Mean of a scope over every sample since the last resetTotals(), 0 if there are none
+    double getMean(const char* name) {
+        const ScopeStats& stats = scopeStats[findStats(name)];
+        return stats.count == 0 ? 0.0 : stats.total / stats.count;
+    }
+
+    // Starts a new measurement period for getMean(); the rolling windows are kept
+    void resetTotals() {
+        for (auto& stats : scopeStats) {
+            stats.total = 0.0;
+            stats.count = 0;
+        }
+    }
+
+    VkDeviceSize getUploadBytes() const { return uploadBytes; }
+    double getUploadMilliseconds() const { return uploadMilliseconds; }
+
+private:
+    struct ScopeStats {
+        std::string name;
+        std::vector<double> samples;
+        size_t next = 0;
+        double total = 0.0;
+        uint64_t count = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    PFN_vkResetQueryPoolEXT hostResetQueryPool = nullptr;
+    float timestampPeriod = 1.0f;
+    uint64_t graphicsMask = 0;
+    uint64_t transferMask = 0;
+    bool transferCommandReset = false;
+    bool uploadTiming = false;
+
+    VkQueryPool frameQueryPool = VK_NULL_HANDLE;
+    // Per frame in flight: the stats entry of each scope written this frame, in query order
+    std::vector<uint32_t> frameScopes[MAX_FRAMES_IN_FLIGHT];
+    std::vector<VkQueryPool> uploadQueryPools;
+
+    std::vector<ScopeStats> scopeStats;
+    VkDeviceSize uploadBytes = 0;
+    double uploadMilliseconds = 0.0;
+
+    static uint64_t validBitsMask(uint32_t validBits) {
+        return validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    }
+
+    uint32_t frameQuery(size_t frame, uint32_t scope) const {
+        return static_cast<uint32_t>(frame * PROFILER_SCOPES_PER_FRAME * 2 + scope * 2);
+    }
+
+    // Only the low validBits of a timestamp are meaningful; the masked difference also survives a wrap-around
+    double toMilliseconds(uint64_t begin, uint64_t end, uint64_t mask) const {
+        return static_cast<double>((end - begin) & mask) * timestampPeriod / 1e6;
+    }
+
+    uint32_t findStats(const char* name) {
+        for (uint32_t i = 0; i < scopeStats.size(); i++) {
+            if (scopeStats[i].name == name) {
+                return i;
+            }
+        }
+        scopeStats.push_back({name, {}, 0, 0.0, 0});
+        return static_cast<uint32_t>(scopeStats.size() - 1);
+    }
+
+    void addSample(uint32_t index, double milliseconds) {
+        ScopeStats& stats = scopeStats[index];
+        stats.total += milliseconds;
+        stats.count++;
+        if (stats.samples.size() < PROFILER_WINDOW) {
+            stats.samples.push_back(milliseconds);
+        } else {
+            stats.samples[stats.next] = milliseconds;
+            stats.next = (stats.next + 1) % PROFILER_WINDOW;
+        }
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+// Runtime-sized descriptor arrays; instances of one draw may use different textures, hence nonuniformEXT()
+#extension GL_EXT_nonuniform_qualifier : enable
+
+// Materials and textures come from the bindless set (see bindless.hpp); the vertex shader picks the material per object
+struct Material {
+    vec4 tint;
+    uint textureIndex;
+};
+
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(set = 1, binding = 1) uniform sampler textureSampler;
+layout(std430, set = 1, binding = 2) readonly buffer MaterialTable {
+    Material materials[];
+};
+
+layout(location = 0) in vec3 inVertexColor;
+layout(location = 1) in vec2 inTexturePosition;
+layout(location = 2) flat in uint inMaterialIndex;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    Material material = materials[inMaterialIndex];
+    outColor = material.tint * texture(sampler2D(textures[nonuniformEXT(material.textureIndex)], textureSampler), inTexturePosition);
+}
@@ -0,0 +1,36 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform CameraUniforms {
+    mat4 view;
+    mat4 projection;
+} camera;
+
+// Shared with shaders/main.vs; the whole batch is one draw, so only materialIndex matters here
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+    uint objectIndex;
+    uint materialIndex;
+} draw;
+
+// Must match BINDLESS_MATERIAL_PALETTE_SIZE
+const uint MATERIAL_PALETTE_SIZE = 8;
+
+layout(location = 0) in vec3 inVertexPosition;
+layout(location = 1) in vec3 inVertexColor;
+layout(location = 2) in vec2 inTexturePosition;
+// Per instance (binding 1): the model matrix takes one location per column, then the object it belongs to
+layout(location = 3) in mat4 inInstanceModel;
+layout(location = 7) in uint inInstanceObject;
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec2 outTexturePosition;
+// Only read by the bindless fragment shader
+layout(location = 2) flat out uint outMaterialIndex;
+
+void main() {
+    gl_Position = camera.projection * camera.view * inInstanceModel * vec4(inVertexPosition, 1.0);
+    outColor = inVertexColor;
+    outTexturePosition = inTexturePosition;
+    outMaterialIndex = draw.materialIndex + inInstanceObject % MATERIAL_PALETTE_SIZE;
+}
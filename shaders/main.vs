@@ -1,22 +1,34 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(set = 0, binding = 0) uniform UniformBufferObject {
-    mat4 model;
+// Per frame
+layout(set = 0, binding = 0) uniform CameraUniforms {
     mat4 view;
     mat4 projection;
-} ubo;
+} camera;
+
+// Per draw
+layout(push_constant) uniform DrawConstants {
+    mat4 model;
+    uint objectIndex;
+    uint materialIndex;
+} draw;
 
-layout(location = 0) in vec2 inVertexPosition;
+layout(location = 0) in vec3 inVertexPosition;
 layout(location = 1) in vec3 inVertexColor;
 layout(location = 2) in vec2 inTexturePosition;
 
+// Must match BINDLESS_MATERIAL_PALETTE_SIZE
+const uint MATERIAL_PALETTE_SIZE = 8;
+
 layout(location = 0) out vec3 outColor;
 layout(location = 1) out vec2 outTexturePosition;
+// Only read by the bindless fragment shader
+layout(location = 2) flat out uint outMaterialIndex;
 
 void main() {
-    gl_Position = vec4(inVertexPosition, 0.0, 1.0);
-    // gl_Position = ubo.projection * ubo.view * ubo.model * vec4(inVertexPosition, 0.0, 1.0);
+    gl_Position = camera.projection * camera.view * draw.model * vec4(inVertexPosition, 1.0);
     outColor = inVertexColor;
     outTexturePosition = inTexturePosition;
+    outMaterialIndex = draw.materialIndex + draw.objectIndex % MATERIAL_PALETTE_SIZE;
 }
\ No newline at end of file
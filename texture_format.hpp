@@ -0,0 +1,366 @@
+#if !defined(TEXTURE_FORMAT)
+#define TEXTURE_FORMAT
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "mipmaps.hpp"
+
+/********************************************************************************************************************************/
+// Cooked textures (.lvtex): every mip level precomputed and stored in the layout vkCmdCopyBufferToImage expects, so loading
+// is a read and a copy. BC1 holds opaque images (8 bytes per 4x4 block), BC3 images with alpha (16 bytes per block).
+//
+//     TextureFileHeader | TextureFileLevel[mipLevels] | level data (offsets relative to the end of the level table)
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1,
+    BC3 = 2,
+};
+
+struct TextureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    TextureFormat format;
+    uint32_t srgb;
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t reserved;
+    uint64_t dataSize;
+};
+
+struct TextureFileLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset;
+    uint64_t size;
+};
+
+const uint32_t TEXTURE_FILE_MAGIC = 0x5854564c; // "LVTX"
+const uint32_t TEXTURE_FILE_VERSION = 1;
+
+struct CookedTexture {
+    TextureFormat format = TextureFormat::RGBA8;
+    bool srgb = true;
+    MipChain chain;
+};
+
+// A cooked texture read in place; `data` points into memory owned by the caller
+struct CookedTextureView {
+    TextureFormat format = TextureFormat::RGBA8;
+    bool srgb = true;
+    std::vector<MipLevel> levels;
+    const uint8_t* data = nullptr;
+};
+
+inline const char* textureFormatName(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RGBA8: return "RGBA8";
+        case TextureFormat::BC1: return "BC1";
+        case TextureFormat::BC3: return "BC3";
+    }
+    return "unknown";
+}
+
+// Bytes per 4x4 block, 0 for uncompressed formats
+inline uint32_t textureBlockSize(TextureFormat format) {
+    return format == TextureFormat::BC1 ? 8 : format == TextureFormat::BC3 ? 16 : 0;
+}
+
+inline size_t textureLevelSize(TextureFormat format, uint32_t width, uint32_t height) {
+    uint32_t blockSize = textureBlockSize(format);
+    if (blockSize == 0) {
+        return static_cast<size_t>(width) * height * 4;
+    }
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+/********************************************************************************************************************************/
+// Block encoders. Endpoints come from the bounding box of the block, inset by 1/16 of its extent so the interpolated
+// colors land closer to the actual texels; each texel then takes the nearest palette entry.
+namespace bc {
+
+inline uint16_t packRgb565(const uint8_t* color) {
+    return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+inline void unpackRgb565(uint16_t packed, uint8_t* color) {
+    uint8_t r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    color[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    color[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    color[3] = 255;
+}
+
+// Always the four-color mode, which is also the only one BC3 color blocks use
+inline void colorPalette(uint16_t color0, uint16_t color1, uint8_t palette[4][4]) {
+    unpackRgb565(color0, palette[0]);
+    unpackRgb565(color1, palette[1]);
+    for (int c = 0; c < 4; c++) {
+        palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+        palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+    }
+}
+
+inline void alphaPalette(uint8_t alpha0, uint8_t alpha1, uint8_t palette[8]) {
+    palette[0] = alpha0;
+    palette[1] = alpha1;
+    if (alpha0 > alpha1) {
+        for (int i = 1; i < 7; i++) {
+            palette[i + 1] = static_cast<uint8_t>(((7 - i) * alpha0 + i * alpha1) / 7);
+        }
+    } else {
+        for (int i = 1; i < 5; i++) {
+            palette[i + 1] = static_cast<uint8_t>(((5 - i) * alpha0 + i * alpha1) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// texels: 16 RGBA8 texels in row order
+inline void encodeColorBlock(const uint8_t texels[16][4], uint8_t* out) {
+    uint8_t minColor[3] = {255, 255, 255}, maxColor[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            minColor[c] = std::min(minColor[c], texels[i][c]);
+            maxColor[c] = std::max(maxColor[c], texels[i][c]);
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        int inset = (maxColor[c] - minColor[c]) / 16;
+        minColor[c] = static_cast<uint8_t>(minColor[c] + inset);
+        maxColor[c] = static_cast<uint8_t>(maxColor[c] - inset);
+    }
+
+    uint16_t color0 = packRgb565(maxColor), color1 = packRgb565(minColor);
+    uint32_t indices = 0;
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+    if (color0 != color1) {
+        uint8_t palette[4][4];
+        colorPalette(color0, color1, palette);
+        for (int i = 0; i < 16; i++) {
+            uint32_t best = 0, bestDistance = UINT32_MAX;
+            for (uint32_t p = 0; p < 4; p++) {
+                uint32_t distance = 0;
+                for (int c = 0; c < 3; c++) {
+                    int d = texels[i][c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+
+    memcpy(out, &color0, 2);
+    memcpy(out + 2, &color1, 2);
+    memcpy(out + 4, &indices, 4);
+}
+
+inline void encodeAlphaBlock(const uint8_t texels[16][4], uint8_t* out) {
+    uint8_t minAlpha = 255, maxAlpha = 0;
+    for (int i = 0; i < 16; i++) {
+        minAlpha = std::min(minAlpha, texels[i][3]);
+        maxAlpha = std::max(maxAlpha, texels[i][3]);
+    }
+
+    uint64_t indices = 0;
+    if (maxAlpha != minAlpha) {
+        uint8_t palette[8];
+        alphaPalette(maxAlpha, minAlpha, palette);
+        for (int i = 0; i < 16; i++) {
+            uint64_t best = 0;
+            int bestDistance = 256;
+            for (uint64_t p = 0; p < 8; p++) {
+                int distance = std::abs(texels[i][3] - palette[p]);
+                if (distance < bestDistance) {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            indices |= best << (i * 3);
+        }
+    }
+
+    out[0] = maxAlpha;
+    out[1] = minAlpha;
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+    }
+}
+
+inline void decodeColorBlock(const uint8_t* block, uint8_t texels[16][4]) {
+    uint16_t color0, color1;
+    uint32_t indices;
+    memcpy(&color0, block, 2);
+    memcpy(&color1, block + 2, 2);
+    memcpy(&indices, block + 4, 4);
+
+    uint8_t palette[4][4];
+    colorPalette(color0, color1, palette);
+    for (int i = 0; i < 16; i++) {
+        memcpy(texels[i], palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+inline void decodeAlphaBlock(const uint8_t* block, uint8_t texels[16][4]) {
+    uint8_t palette[8];
+    alphaPalette(block[0], block[1], palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; i++) {
+        texels[i][3] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+} // namespace bc
+
+// RGBA8 level -> blocks; partial blocks at the right and bottom edges repeat the last row/column
+inline void compressLevel(const uint8_t* pixels, uint32_t width, uint32_t height, TextureFormat format, uint8_t* out) {
+    uint32_t blockSize = textureBlockSize(format);
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            uint8_t texels[16][4];
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx + i % 4, width - 1), y = std::min(by + i / 4, height - 1);
+                memcpy(texels[i], pixels + (static_cast<size_t>(y) * width + x) * 4, 4);
+            }
+            if (format == TextureFormat::BC3) {
+                bc::encodeAlphaBlock(texels, out);
+                bc::encodeColorBlock(texels, out + 8);
+            } else {
+                bc::encodeColorBlock(texels, out);
+            }
+            out += blockSize;
+        }
+    }
+}
+
+// Blocks -> RGBA8 level, for devices that cannot sample the compressed format
+inline void decompressLevel(const uint8_t* blocks, uint32_t width, uint32_t height, TextureFormat format, uint8_t* out) {
+    uint32_t blockSize = textureBlockSize(format);
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            uint8_t texels[16][4];
+            if (format == TextureFormat::BC3) {
+                bc::decodeColorBlock(blocks + 8, texels);
+                bc::decodeAlphaBlock(blocks, texels);
+            } else {
+                bc::decodeColorBlock(blocks, texels);
+            }
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = bx + i % 4, y = by + i / 4;
+                if (x < width && y < height) {
+                    memcpy(out + (static_cast<size_t>(y) * width + x) * 4, texels[i], 4);
+                }
+            }
+            blocks += blockSize;
+        }
+    }
+}
+
+// Re-encodes every level of an RGBA8 chain
+inline MipChain compressMipChain(const MipChain& source, TextureFormat format) {
+    MipChain chain;
+    size_t totalSize = 0;
+    for (const MipLevel& level : source.levels) {
+        chain.levels.push_back({level.width, level.height, totalSize, textureLevelSize(format, level.width, level.height)});
+        totalSize += chain.levels.back().size;
+    }
+    chain.data.resize(totalSize);
+    for (size_t i = 0; i < source.levels.size(); i++) {
+        const MipLevel& level = source.levels[i];
+        compressLevel(source.data.data() + level.offset, level.width, level.height, format, chain.data.data() + chain.levels[i].offset);
+    }
+    return chain;
+}
+
+inline MipChain decompressMipChain(const std::vector<MipLevel>& levels, const uint8_t* data, TextureFormat format) {
+    MipChain chain;
+    size_t totalSize = 0;
+    for (const MipLevel& level : levels) {
+        chain.levels.push_back({level.width, level.height, totalSize, textureLevelSize(TextureFormat::RGBA8, level.width, level.height)});
+        totalSize += chain.levels.back().size;
+    }
+    chain.data.resize(totalSize);
+    for (size_t i = 0; i < levels.size(); i++) {
+        const MipLevel& level = levels[i];
+        decompressLevel(data + level.offset, level.width, level.height, format, chain.data.data() + chain.levels[i].offset);
+    }
+    return chain;
+}
+
+inline bool writeCookedTexture(const std::string& path, const CookedTexture& texture) {
+    TextureFileHeader header{};
+    header.magic = TEXTURE_FILE_MAGIC;
+    header.version = TEXTURE_FILE_VERSION;
+    header.format = texture.format;
+    header.srgb = texture.srgb ? 1 : 0;
+    header.width = texture.chain.levels[0].width;
+    header.height = texture.chain.levels[0].height;
+    header.mipLevels = static_cast<uint32_t>(texture.chain.levels.size());
+    header.dataSize = texture.chain.data.size();
+
+    std::vector<TextureFileLevel> levels;
+    for (const MipLevel& level : texture.chain.levels) {
+        levels.push_back({level.width, level.height, level.offset, level.size});
+    }
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    ofs.write(reinterpret_cast<const char*>(levels.data()), levels.size() * sizeof(TextureFileLevel));
+    ofs.write(reinterpret_cast<const char*>(texture.chain.data.data()), texture.chain.data.size());
+    return ofs.good();
+}
+
+// Parses a cooked texture in place (e.g. a mapped file); level data stays in `file`. False if it is not a valid one.
+inline bool parseCookedTexture(const uint8_t* file, size_t fileSize, CookedTextureView& texture) {
+    TextureFileHeader header{};
+    if (fileSize < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, file, sizeof(header));
+    if (header.magic != TEXTURE_FILE_MAGIC || header.version != TEXTURE_FILE_VERSION || header.format > TextureFormat::BC3
+        || header.width == 0 || header.height == 0 || header.mipLevels == 0 || header.mipLevels > 32) {
+        return false;
+    }
+    size_t dataOffset = sizeof(header) + header.mipLevels * sizeof(TextureFileLevel);
+    if (fileSize < dataOffset || fileSize - dataOffset < header.dataSize) {
+        return false;
+    }
+
+    texture.format = header.format;
+    texture.srgb = header.srgb != 0;
+    texture.levels.clear();
+    for (uint32_t i = 0; i < header.mipLevels; i++) {
+        TextureFileLevel level;
+        memcpy(&level, file + sizeof(header) + i * sizeof(TextureFileLevel), sizeof(level));
+        // Each level halves the one before it, down to 1
+        if (level.width != std::max(1u, header.width >> i) || level.height != std::max(1u, header.height >> i)) {
+            return false;
+        }
+        // Written so that a huge offset or size cannot wrap around
+        if (level.size != textureLevelSize(header.format, level.width, level.height) || level.offset > header.dataSize || level.size > header.dataSize - level.offset) {
+            return false;
+        }
+        texture.levels.push_back({level.width, level.height, static_cast<size_t>(level.offset), static_cast<size_t>(level.size)});
+    }
+    texture.data = file + dataOffset;
+    return true;
+}
+/********************************************************************************************************************************/
+
+#endif
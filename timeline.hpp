@@ -0,0 +1,80 @@
+#if !defined(TIMELINE)
+#define TIMELINE
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "main.hpp"
+
+/********************************************************************************************************************************/
+// Timeline semaphore (Vulkan 1.2, or VK_KHR_timeline_semaphore): a 64-bit counter signaled by queue submissions with ever
+// increasing values. One semaphore replaces a fence per submission: the CPU waits for or polls a value, the GPU waits on one.
+// The entry points are loaded by the caller, core or KHR depending on what the device offers.
+struct TimelineFunctions {
+    PFN_vkWaitSemaphoresKHR waitSemaphores = nullptr;
+    PFN_vkGetSemaphoreCounterValueKHR getSemaphoreCounterValue = nullptr;
+};
+
+class TimelineSemaphore
+{
+public:
+    void init(VkDevice device, const TimelineFunctions& functions) {
+        this->device = device;
+        this->functions = functions;
+
+        VkSemaphoreTypeCreateInfo typeCreateInfo{};
+        typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeCreateInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeCreateInfo;
+        vkCritical(vkCreateSemaphore(device, &createInfo, nullptr, &semaphore));
+    }
+
+    void destroy() {
+        vkDestroySemaphore(device, semaphore, nullptr);
+        semaphore = VK_NULL_HANDLE;
+    }
+
+    VkSemaphore get() const { return semaphore; }
+
+    // Non-blocking; the counter is only queried when the cached value is not enough
+    bool isComplete(uint64_t value) {
+        if (value > completedValue) {
+            vkCritical(functions.getSemaphoreCounterValue(device, semaphore, &completedValue));
+        }
+        return value <= completedValue;
+    }
+
+    uint64_t getCompletedValue() {
+        vkCritical(functions.getSemaphoreCounterValue(device, semaphore, &completedValue));
+        return completedValue;
+    }
+
+    void wait(uint64_t value) {
+        if (isComplete(value)) {
+            return;
+        }
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &semaphore;
+        waitInfo.pValues = &value;
+        vkCritical(functions.waitSemaphores(device, &waitInfo, std::numeric_limits<uint64_t>::max()));
+        completedValue = std::max(completedValue, value);
+    }
+
+private:
+    VkDevice device = VK_NULL_HANDLE;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    TimelineFunctions functions;
+    uint64_t completedValue = 0;
+};
+/********************************************************************************************************************************/
+
+#endif
@@ -0,0 +1,350 @@
+#if !defined(TRANSFER)
+#define TRANSFER
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "main.hpp"
+#include "allocator.hpp"
+#include "profiler.hpp"
+#include "timeline.hpp"
+
+/********************************************************************************************************************************/
+// Records uploads (staging copies + layout transitions) into one command buffer per batch and submits them without blocking.
+// Batch tickets are the values the batches signal on the transfer timeline, so completion is one counter read. On a dedicated
+// transfer queue the graphics queue waits on the timeline for the last submitted ticket; on a shared queue a barrier is enough.
+class TransferScheduler
+{
+public:
+    struct StagingRange {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        void* mapped;
+    };
+
+    void init(VkDevice device, MemoryAllocator* allocator, GpuProfiler* profiler, const TimelineFunctions& timelineFunctions, uint32_t transferFamily, VkQueue transferQueue,
+        bool dedicatedQueue, VkDeviceSize copyOffsetAlignment) {
+        this->device = device;
+        this->allocator = allocator;
+        this->profiler = profiler;
+        this->transferQueue = transferQueue;
+        this->dedicatedQueue = dedicatedQueue;
+        this->copyOffsetAlignment = std::max<VkDeviceSize>(copyOffsetAlignment, 16);
+        timeline.init(device, timelineFunctions);
+
+        VkCommandPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        createInfo.queueFamilyIndex = transferFamily;
+        createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        vkCritical(vkCreateCommandPool(device, &createInfo, nullptr, &commandPool));
+    }
+
+    void destroy() {
+        timeline.wait(getSubmittedTicket());
+        poll();
+        // A batch that was opened but never submitted still owns its staging chunks
+        if (open.has_value()) {
+            for (auto& staging : open->staging) {
+                destroyStaging(staging);
+            }
+            open.reset();
+        }
+        for (auto& staging : freeStaging) {
+            destroyStaging(staging);
+        }
+        freeStaging.clear();
+        for (auto& batch : freeBatches) {
+            vkFreeCommandBuffers(device, commandPool, 1, &batch.commandBuffer);
+        }
+        vkDestroyCommandPool(device, commandPool, nullptr);
+        timeline.destroy();
+    }
+
+    // Reserve host-visible staging memory for the open batch; its chunk is recycled once the batch completes
+    StagingRange stage(VkDeviceSize size) {
+        Batch& batch = openBatch();
+
+        VkDeviceSize offset = (batch.stagingHead + copyOffsetAlignment - 1) / copyOffsetAlignment * copyOffsetAlignment;
+        if (batch.staging.empty() || offset + size > batch.stagingCapacity) {
+            batch.staging.push_back(acquireStaging(size));
+            batch.stagingCapacity = batch.staging.back().capacity;
+            offset = 0;
+        }
+        batch.stagingHead = offset + size;
+
+        const Staging& staging = batch.staging.back();
+        return {staging.buffer, offset, size, static_cast<char*>(staging.memory.mapped) + offset};
+    }
+
+    void uploadBuffer(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0) {
+        StagingRange range = stage(size);
+        memcpy(range.mapped, data, static_cast<size_t>(size));
+        copyBuffer(range, size, dstBuffer, dstOffset);
+    }
+
+    void copyBuffer(const StagingRange& range, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0) {
+        Batch& batch = openBatch();
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = range.offset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(batch.commandBuffer, range.buffer, dstBuffer, 1, &copyRegion);
+
+        batch.bytes += size;
+    }
+
+    void uploadImage(const void* data, VkDeviceSize size, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel = 0, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        StagingRange range = stage(size);
+        memcpy(range.mapped, data, static_cast<size_t>(size));
+        copyImage(range, image, width, height, mipLevel, finalLayout);
+    }
+
+    // For one mip level: UNDEFINED -> TRANSFER_DST, copy, TRANSFER_DST -> finalLayout (SHADER_READ_ONLY, or TRANSFER_SRC when
+    // the graphics queue derives the remaining levels from it)
+    void copyImage(const StagingRange& range, VkImage image, uint32_t width, uint32_t height, uint32_t mipLevel = 0, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+        Batch& batch = openBatch();
+
+        VkImageMemoryBarrier imageMemoryBarrier{};
+        imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageMemoryBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageMemoryBarrier.image = image;
+        imageMemoryBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        imageMemoryBarrier.subresourceRange.baseMipLevel = mipLevel;
+        imageMemoryBarrier.subresourceRange.levelCount = 1;
+        imageMemoryBarrier.subresourceRange.baseArrayLayer = 0;
+        imageMemoryBarrier.subresourceRange.layerCount = 1;
+        imageMemoryBarrier.srcAccessMask = 0;
+        imageMemoryBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = range.offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = mipLevel;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {width, height, 1};
+        vkCmdCopyBufferToImage(batch.commandBuffer, range.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        // The layout transition is recorded here either way; visibility to the graphics queue comes from the batch semaphore
+        // on a dedicated queue, or from the stage masks of this barrier on a shared one
+        imageMemoryBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        imageMemoryBarrier.newLayout = finalLayout;
+        imageMemoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bool blitSource = finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageMemoryBarrier.dstAccessMask = dedicatedQueue ? 0 : (blitSource ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT);
+        VkPipelineStageFlags dstStage = dedicatedQueue ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : (blitSource ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+        batch.bytes += range.size;
+    }
+
+    // Close and submit the open batch; returns a ticket to test with isComplete(), or the last ticket if nothing was recorded
+    uint64_t submit() {
+        if (!open.has_value()) {
+            return nextTicket - 1;
+        }
+        Batch batch = std::move(open.value());
+        open.reset();
+
+        if (!dedicatedQueue) {
+            // Make buffer writes visible to every later graphics submission on this queue
+            VkMemoryBarrier memoryBarrier{};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memoryBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            memoryBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+            vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+        }
+        profiler->endUpload(batch.commandBuffer, batch.queryPool);
+        vkCritical(vkEndCommandBuffer(batch.commandBuffer));
+
+        batch.ticket = nextTicket++;
+        VkSemaphore semaphore = timeline.get();
+        VkTimelineSemaphoreSubmitInfo timelineSubmitInfo{};
+        timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineSubmitInfo.signalSemaphoreValueCount = 1;
+        timelineSubmitInfo.pSignalSemaphoreValues = &batch.ticket;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineSubmitInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &semaphore;
+        vkCritical(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+        totalBytes += batch.bytes;
+        totalBatches++;
+        uint64_t ticket = batch.ticket;
+        inFlight.push_back(std::move(batch));
+        return ticket;
+    }
+
+    // Adds a wait for every batch submitted since the last graphics submission: one timeline value covers all of them, and
+    // later submissions on the graphics queue are ordered after it anyway
+    void takeWait(std::vector<VkSemaphore>& semaphores, std::vector<uint64_t>& values, std::vector<VkPipelineStageFlags>& stages) {
+        if (!dedicatedQueue || waitedTicket == getSubmittedTicket()) {
+            return;
+        }
+        waitedTicket = getSubmittedTicket();
+        semaphores.push_back(timeline.get());
+        values.push_back(waitedTicket);
+        stages.push_back(VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+
+    // Non-blocking: recycle batches whose ticket the timeline has reached
+    void poll() {
+        while (!inFlight.empty() && timeline.isComplete(inFlight.front().ticket)) {
+            Batch& batch = inFlight.front();
+            // Chunks of the standard size go back to the free list; larger ones were made for one oversized upload
+            for (auto& staging : batch.staging) {
+                if (staging.capacity == TRANSFER_STAGING_CHUNK_SIZE) {
+                    freeStaging.push_back(staging);
+                } else {
+                    destroyStaging(staging);
+                }
+            }
+            completedTicket = batch.ticket;
+            profiler->collectUpload(batch.queryPool, batch.bytes);
+
+            Batch recycled{};
+            recycled.commandBuffer = batch.commandBuffer;
+            recycled.queryPool = batch.queryPool;
+            freeBatches.push_back(recycled);
+            inFlight.pop_front();
+        }
+    }
+
+    bool isComplete(uint64_t ticket) {
+        poll();
+        return ticket <= completedTicket;
+    }
+
+    // The ticket the currently open batch will get from submit(), and the last one already submitted
+    uint64_t getOpenTicket() const { return nextTicket; }
+    uint64_t getSubmittedTicket() const { return nextTicket - 1; }
+
+    bool idle() {
+        return !open.has_value() && inFlight.empty();
+    }
+
+    uint64_t getTotalBytes() const { return totalBytes; }
+    uint64_t getTotalBatches() const { return totalBatches; }
+
+private:
+    struct Staging {
+        VkBuffer buffer;
+        Allocation memory;
+        VkDeviceSize capacity;
+    };
+
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // GPU duration of the batch; owned by the profiler, VK_NULL_HANDLE when uploads are not timed
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<Staging> staging;
+        VkDeviceSize stagingHead = 0;
+        VkDeviceSize stagingCapacity = 0;
+        VkDeviceSize bytes = 0;
+        uint64_t ticket = 0;
+    };
+
+    VkDevice device = VK_NULL_HANDLE;
+    MemoryAllocator* allocator = nullptr;
+    GpuProfiler* profiler = nullptr;
+    VkQueue transferQueue = VK_NULL_HANDLE;
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    bool dedicatedQueue = false;
+    VkDeviceSize copyOffsetAlignment = 16;
+
+    std::optional<Batch> open;
+    std::deque<Batch> inFlight;
+    std::vector<Batch> freeBatches;
+    // Staging chunks of completed batches, persistently mapped and reused by later ones
+    std::vector<Staging> freeStaging;
+    TimelineSemaphore timeline;
+
+    uint64_t nextTicket = 1;
+    uint64_t completedTicket = 0;
+    // Last ticket a graphics submission waits on
+    uint64_t waitedTicket = 0;
+    uint64_t totalBytes = 0;
+    uint64_t totalBatches = 0;
+
+    // A recycled chunk when one is free and large enough; a new one of at least TRANSFER_STAGING_CHUNK_SIZE otherwise
+    Staging acquireStaging(VkDeviceSize size) {
+        if (size <= TRANSFER_STAGING_CHUNK_SIZE && !freeStaging.empty()) {
+            Staging staging = freeStaging.back();
+            freeStaging.pop_back();
+            return staging;
+        }
+
+        Staging staging{};
+        staging.capacity = std::max<VkDeviceSize>(size, TRANSFER_STAGING_CHUNK_SIZE);
+
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = staging.capacity;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        vkCritical(vkCreateBuffer(device, &createInfo, nullptr, &staging.buffer));
+
+        VkMemoryRequirements memoryRequirements;
+        vkGetBufferMemoryRequirements(device, staging.buffer, &memoryRequirements);
+        staging.memory = allocator->allocate(memoryRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+        vkCritical(vkBindBufferMemory(device, staging.buffer, staging.memory.memory, staging.memory.offset));
+        return staging;
+    }
+
+    void destroyStaging(Staging& staging) {
+        vkDestroyBuffer(device, staging.buffer, nullptr);
+        allocator->free(staging.memory);
+    }
+
+    Batch& openBatch() {
+        if (open.has_value()) {
+            return open.value();
+        }
+
+        Batch batch{};
+        if (!freeBatches.empty()) {
+            batch = freeBatches.back();
+            freeBatches.pop_back();
+            vkCritical(vkResetCommandBuffer(batch.commandBuffer, 0));
+        } else {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocateInfo.commandPool = commandPool;
+            allocateInfo.commandBufferCount = 1;
+            vkCritical(vkAllocateCommandBuffers(device, &allocateInfo, &batch.commandBuffer));
+            batch.queryPool = profiler->createUploadQueries();
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkCritical(vkBeginCommandBuffer(batch.commandBuffer, &beginInfo));
+        profiler->beginUpload(batch.commandBuffer, batch.queryPool);
+
+        open = std::move(batch);
+        return open.value();
+    }
+};
+/********************************************************************************************************************************/
+
+#endif
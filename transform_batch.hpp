@@ -0,0 +1,323 @@
+#if !defined(TRANSFORM_BATCH)
+#define TRANSFORM_BATCH
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TRANSFORM_BATCH_X86
+#include <immintrin.h>
+// AVX2 code is compiled into the same binary and only selected when the CPU has it
+#if defined(__GNUC__) || defined(__clang__)
+#define TRANSFORM_BATCH_AVX2_TARGET __attribute__((target("avx2,fma")))
+#else
+#define TRANSFORM_BATCH_AVX2_TARGET
+#endif
+#endif
+
+/********************************************************************************************************************************/
+// Batched object transforms: model = translate(x, y, z) * scale * rotateZ(angle) and a bounding sphere test against the
+// frustum for a whole array of objects per call. Input is structure of arrays so 4 (SSE) or 8 (AVX2) objects are processed
+// per iteration; the model matrices of visible objects are written packed, in object order, straight into mapped memory.
+struct TransformBatchInput {
+    const float* x;
+    const float* y;
+    const float* z;
+    // Rotation about the z axis, in radians
+    const float* angle;
+    const float* scale;
+    // Bounding sphere radius in object space
+    const float* radius;
+    uint32_t count;
+};
+
+struct TransformBatchOutput {
+    // Column-major model matrices of the visible objects, `stride` bytes apart (sizeof(glm::mat4) or a uniform slot)
+    uint8_t* models;
+    size_t stride;
+    // Optional: bit i % 32 of word i / 32 is set if object i is visible
+    uint32_t* visibilityMask;
+};
+
+enum class TransformKernel {
+    Scalar,
+    SSE,
+    AVX2,
+};
+
+inline const char* transformKernelName(TransformKernel kernel) {
+    switch (kernel) {
+    case TransformKernel::SSE:
+        return "SSE";
+    case TransformKernel::AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+inline bool isTransformKernelSupported(TransformKernel kernel) {
+    switch (kernel) {
+#if defined(TRANSFORM_BATCH_X86)
+    case TransformKernel::SSE:
+        return true;
+#if defined(__GNUC__) || defined(__clang__)
+    case TransformKernel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#endif
+    case TransformKernel::Scalar:
+        return true;
+    default:
+        return false;
+    }
+}
+
+inline TransformKernel detectTransformKernel() {
+    if (isTransformKernelSupported(TransformKernel::AVX2)) {
+        return TransformKernel::AVX2;
+    }
+    return isTransformKernelSupported(TransformKernel::SSE) ? TransformKernel::SSE : TransformKernel::Scalar;
+}
+
+// Left, right, bottom, top, near, far as (normal, distance) with inward normals of unit length (Gribb & Hartmann)
+inline void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++) {
+        rows[row] = glm::vec4(viewProjection[0][row], viewProjection[1][row], viewProjection[2][row], viewProjection[3][row]);
+    }
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 plane = i % 2 == 0 ? rows[3] + rows[i / 2] : rows[3] - rows[i / 2];
+        planes[i] = plane / glm::length(glm::vec3(plane));
+    }
+}
+
+namespace transform_batch {
+
+// sin/cos by quadrant: angle = j * pi/2 + r with |r| <= pi/4 (pi/2 split in three parts so the reduction stays exact), then
+// minimax polynomials for sin(r) and cos(r) (Cephes sinf/cosf coefficients)
+const float TWO_OVER_PI = 0.636619772367581343f;
+const float PI_OVER_TWO_1 = 1.5703125f;
+const float PI_OVER_TWO_2 = 4.837512969970703125e-4f;
+const float PI_OVER_TWO_3 = 7.54978995489188216e-8f;
+const float SIN_1 = -1.6666654611e-1f;
+const float SIN_2 = 8.3321608736e-3f;
+const float SIN_3 = -1.9515295891e-4f;
+const float COS_1 = 4.166664568298827e-2f;
+const float COS_2 = -1.388731625493765e-3f;
+const float COS_3 = 2.443315711809948e-5f;
+
+inline bool isVisible(const glm::vec4 planes[6], float x, float y, float z, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (planes[i].x * x + planes[i].y * y + planes[i].z * z + planes[i].w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void markVisible(const TransformBatchOutput& output, uint32_t index, uint32_t laneMask) {
+    if (output.visibilityMask != nullptr) {
+        output.visibilityMask[index / 32] |= laneMask << (index % 32);
+    }
+}
+
+inline uint32_t runScalar(const TransformBatchInput& input, const glm::vec4 planes[6], const TransformBatchOutput& output, uint32_t begin, uint32_t& visible) {
+    for (uint32_t i = begin; i < input.count; i++) {
+        float scale = input.scale[i];
+        if (!isVisible(planes, input.x[i], input.y[i], input.z[i], input.radius[i] * scale)) {
+            continue;
+        }
+        float scaledCos = scale * std::cos(input.angle[i]);
+        float scaledSin = scale * std::sin(input.angle[i]);
+        const float model[16] = {
+            scaledCos, scaledSin, 0.0f, 0.0f,
+            -scaledSin, scaledCos, 0.0f, 0.0f,
+            0.0f, 0.0f, scale, 0.0f,
+            input.x[i], input.y[i], input.z[i], 1.0f,
+        };
+        memcpy(output.models + visible * output.stride, model, sizeof(model));
+        markVisible(output, i, 1);
+        visible++;
+    }
+    return input.count;
+}
+
+#if defined(TRANSFORM_BATCH_X86)
+inline void sinCos4(__m128 angle, __m128& sine, __m128& cosine) {
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(angle, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 j = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(angle, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_TWO_1)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_TWO_2)));
+    r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(PI_OVER_TWO_3)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_3), r2), _mm_set1_ps(SIN_2));
+    sinPolynomial = _mm_add_ps(_mm_mul_ps(sinPolynomial, r2), _mm_set1_ps(SIN_1));
+    sinPolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPolynomial, r2), r), r);
+    __m128 cosPolynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_3), r2), _mm_set1_ps(COS_2));
+    cosPolynomial = _mm_add_ps(_mm_mul_ps(cosPolynomial, r2), _mm_set1_ps(COS_1));
+    cosPolynomial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cosPolynomial, r2), r2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))));
+
+    // Odd quadrants swap sin and cos; sin is negated in quadrants 2 and 3, cos in quadrants 1 and 2
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosPolynomial), _mm_andnot_ps(swap, sinPolynomial)), sinSign);
+    cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sinPolynomial), _mm_andnot_ps(swap, cosPolynomial)), cosSign);
+}
+
+// Four objects in lanes -> four matrices: each column is a 4x4 transpose of per-lane components
+inline void storeVisible4(__m128 scaledCos, __m128 scaledSin, __m128 scale, __m128 x, __m128 y, __m128 z, int laneMask, uint32_t index,
+    const TransformBatchOutput& output, uint32_t& visible) {
+    if (laneMask == 0) {
+        return;
+    }
+    __m128 zero = _mm_setzero_ps();
+    __m128 column0[4] = {scaledCos, scaledSin, zero, zero};
+    __m128 column1[4] = {_mm_sub_ps(zero, scaledSin), scaledCos, zero, zero};
+    __m128 column2[4] = {zero, zero, scale, zero};
+    __m128 column3[4] = {x, y, z, _mm_set1_ps(1.0f)};
+    _MM_TRANSPOSE4_PS(column0[0], column0[1], column0[2], column0[3]);
+    _MM_TRANSPOSE4_PS(column1[0], column1[1], column1[2], column1[3]);
+    _MM_TRANSPOSE4_PS(column2[0], column2[1], column2[2], column2[3]);
+    _MM_TRANSPOSE4_PS(column3[0], column3[1], column3[2], column3[3]);
+    for (int lane = 0; lane < 4; lane++) {
+        if ((laneMask & (1 << lane)) == 0) {
+            continue;
+        }
+        float* model = reinterpret_cast<float*>(output.models + visible * output.stride);
+        _mm_storeu_ps(model, column0[lane]);
+        _mm_storeu_ps(model + 4, column1[lane]);
+        _mm_storeu_ps(model + 8, column2[lane]);
+        _mm_storeu_ps(model + 12, column3[lane]);
+        visible++;
+    }
+    markVisible(output, index, static_cast<uint32_t>(laneMask));
+}
+
+inline uint32_t runSSE(const TransformBatchInput& input, const glm::vec4 planes[6], const TransformBatchOutput& output, uint32_t& visible) {
+    __m128 plane[6][4];
+    for (int i = 0; i < 6; i++) {
+        for (int component = 0; component < 4; component++) {
+            plane[i][component] = _mm_set1_ps(planes[i][component]);
+        }
+    }
+
+    uint32_t end = input.count & ~3u;
+    for (uint32_t i = 0; i < end; i += 4) {
+        __m128 x = _mm_loadu_ps(input.x + i);
+        __m128 y = _mm_loadu_ps(input.y + i);
+        __m128 z = _mm_loadu_ps(input.z + i);
+        __m128 scale = _mm_loadu_ps(input.scale + i);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(_mm_loadu_ps(input.radius + i), scale));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane[p][0], x), _mm_mul_ps(plane[p][1], y)), _mm_add_ps(_mm_mul_ps(plane[p][2], z), plane[p][3]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+        }
+        int laneMask = _mm_movemask_ps(inside);
+        if (laneMask == 0) {
+            continue;
+        }
+
+        __m128 sine, cosine;
+        sinCos4(_mm_loadu_ps(input.angle + i), sine, cosine);
+        storeVisible4(_mm_mul_ps(cosine, scale), _mm_mul_ps(sine, scale), scale, x, y, z, laneMask, i, output, visible);
+    }
+    return end;
+}
+
+TRANSFORM_BATCH_AVX2_TARGET
+inline void sinCos8(__m256 angle, __m256& sine, __m256& cosine) {
+    __m256i quadrant = _mm256_cvtps_epi32(_mm256_mul_ps(angle, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256 j = _mm256_cvtepi32_ps(quadrant);
+    __m256 r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PI_OVER_TWO_1), angle);
+    r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PI_OVER_TWO_2), r);
+    r = _mm256_fnmadd_ps(j, _mm256_set1_ps(PI_OVER_TWO_3), r);
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 sinPolynomial = _mm256_fmadd_ps(_mm256_set1_ps(SIN_3), r2, _mm256_set1_ps(SIN_2));
+    sinPolynomial = _mm256_fmadd_ps(sinPolynomial, r2, _mm256_set1_ps(SIN_1));
+    sinPolynomial = _mm256_fmadd_ps(_mm256_mul_ps(sinPolynomial, r2), r, r);
+    __m256 cosPolynomial = _mm256_fmadd_ps(_mm256_set1_ps(COS_3), r2, _mm256_set1_ps(COS_2));
+    cosPolynomial = _mm256_fmadd_ps(cosPolynomial, r2, _mm256_set1_ps(COS_1));
+    cosPolynomial = _mm256_fmadd_ps(_mm256_mul_ps(cosPolynomial, r2), r2, _mm256_fnmadd_ps(r2, _mm256_set1_ps(0.5f), _mm256_set1_ps(1.0f)));
+
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(quadrant, _mm256_set1_epi32(2)), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(quadrant, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30));
+    sine = _mm256_xor_ps(_mm256_blendv_ps(sinPolynomial, cosPolynomial, swap), sinSign);
+    cosine = _mm256_xor_ps(_mm256_blendv_ps(cosPolynomial, sinPolynomial, swap), cosSign);
+}
+
+TRANSFORM_BATCH_AVX2_TARGET
+inline uint32_t runAVX2(const TransformBatchInput& input, const glm::vec4 planes[6], const TransformBatchOutput& output, uint32_t& visible) {
+    __m256 plane[6][4];
+    for (int i = 0; i < 6; i++) {
+        for (int component = 0; component < 4; component++) {
+            plane[i][component] = _mm256_set1_ps(planes[i][component]);
+        }
+    }
+
+    uint32_t end = input.count & ~7u;
+    for (uint32_t i = 0; i < end; i += 8) {
+        __m256 x = _mm256_loadu_ps(input.x + i);
+        __m256 y = _mm256_loadu_ps(input.y + i);
+        __m256 z = _mm256_loadu_ps(input.z + i);
+        __m256 scale = _mm256_loadu_ps(input.scale + i);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(_mm256_loadu_ps(input.radius + i), scale));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 distance = _mm256_fmadd_ps(plane[p][0], x, _mm256_fmadd_ps(plane[p][1], y, _mm256_fmadd_ps(plane[p][2], z, plane[p][3])));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+        }
+        int laneMask = _mm256_movemask_ps(inside);
+        if (laneMask == 0) {
+            continue;
+        }
+
+        __m256 sine, cosine;
+        sinCos8(_mm256_loadu_ps(input.angle + i), sine, cosine);
+        __m256 scaledCos = _mm256_mul_ps(cosine, scale);
+        __m256 scaledSin = _mm256_mul_ps(sine, scale);
+        // Matrices are stored through 128-bit halves: the 4x4 transposes do not cross lanes that way
+        storeVisible4(_mm256_castps256_ps128(scaledCos), _mm256_castps256_ps128(scaledSin), _mm256_castps256_ps128(scale), _mm256_castps256_ps128(x),
+            _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), laneMask & 15, i, output, visible);
+        storeVisible4(_mm256_extractf128_ps(scaledCos, 1), _mm256_extractf128_ps(scaledSin, 1), _mm256_extractf128_ps(scale, 1), _mm256_extractf128_ps(x, 1),
+            _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), laneMask >> 4, i + 4, output, visible);
+    }
+    return end;
+}
+#endif
+
+} // namespace transform_batch
+
+// Returns the number of visible objects, i.e. of matrices written. Objects past the last full SIMD batch go through the
+// scalar path.
+inline uint32_t transformBatch(TransformKernel kernel, const TransformBatchInput& input, const glm::vec4 planes[6], const TransformBatchOutput& output) {
+    if (output.visibilityMask != nullptr) {
+        memset(output.visibilityMask, 0, (input.count + 31) / 32 * sizeof(uint32_t));
+    }
+    uint32_t visible = 0, begin = 0;
+    switch (kernel) {
+#if defined(TRANSFORM_BATCH_X86)
+    case TransformKernel::AVX2:
+        begin = transform_batch::runAVX2(input, planes, output, visible);
+        break;
+    case TransformKernel::SSE:
+        begin = transform_batch::runSSE(input, planes, output, visible);
+        break;
+#endif
+    default:
+        break;
+    }
+    transform_batch::runScalar(input, planes, output, begin, visible);
+    return visible;
+}
+/********************************************************************************************************************************/
+
+#endif
@@ -0,0 +1,129 @@
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// C++
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "main.hpp"
+#include "transform_batch.hpp"
+
+/********************************************************************************************************************************/
+// Microbenchmark of the batched transform + culling kernels against the per-object glm path they replace:
+//
+//     transform_bench.app [objects] [iterations]
+//
+// Objects are scattered around the origin and seen by the application's camera, so roughly half of them are culled. Every
+// kernel is checked against the glm results (same visible set, matrices within float rounding). Build with optimizations
+// (-DCMAKE_BUILD_TYPE=Release); the numbers of a debug build are meaningless.
+struct Objects {
+    std::vector<float> x, y, z, angle, scale, radius;
+};
+
+// What updateScene() used to do for each object
+uint32_t transformGlm(const Objects& objects, const glm::vec4 planes[6], uint8_t* models, uint32_t* visibilityMask) {
+    uint32_t count = static_cast<uint32_t>(objects.x.size()), visible = 0;
+    memset(visibilityMask, 0, (count + 31) / 32 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 position(objects.x[i], objects.y[i], objects.z[i]);
+        float radius = objects.radius[i] * objects.scale[i];
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            inside = glm::dot(glm::vec3(planes[p]), position) + planes[p].w >= -radius;
+        }
+        if (!inside) {
+            continue;
+        }
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position) * glm::scale(glm::mat4(1.0f), glm::vec3(objects.scale[i]))
+            * glm::rotate(glm::mat4(1.0f), objects.angle[i], glm::vec3(0.0f, 0.0f, 1.0f));
+        memcpy(models + visible * sizeof(glm::mat4), &model, sizeof(glm::mat4));
+        visibilityMask[i / 32] |= 1u << (i % 32);
+        visible++;
+    }
+    return visible;
+}
+
+template <typename Function>
+double measure(uint32_t iterations, Function function) {
+    function();
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        function();
+    }
+    return std::chrono::duration<double, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    uint32_t count = argc > 1 ? static_cast<uint32_t>(std::max(1ul, std::strtoul(argv[1], nullptr, 10))) : 65536;
+    uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::max(1ul, std::strtoul(argv[2], nullptr, 10))) : 200;
+#if !defined(__OPTIMIZE__) && (defined(__GNUC__) || defined(__clang__))
+    LOG(RED "Warning: unoptimized build, timings are not representative\n" CLEAR);
+#endif
+
+    Objects objects;
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f), angle(0.0f, 6.2831853f), scale(0.01f, 0.1f);
+    for (uint32_t i = 0; i < count; i++) {
+        objects.x.push_back(position(random));
+        objects.y.push_back(position(random));
+        objects.z.push_back(position(random));
+        objects.angle.push_back(angle(random));
+        objects.scale.push_back(scale(random));
+        objects.radius.push_back(0.70710678f);
+    }
+
+    // The application's camera (see updateCamera())
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 10.0f);
+    projection[1][1] *= -1;
+    glm::mat4 view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    glm::vec4 planes[6];
+    extractFrustumPlanes(projection * view, planes);
+
+    std::vector<uint8_t> referenceModels(count * sizeof(glm::mat4)), models(count * sizeof(glm::mat4));
+    std::vector<uint32_t> referenceMask((count + 31) / 32), mask((count + 31) / 32);
+    uint32_t referenceVisible = 0;
+    double referenceTime = measure(iterations, [&] {
+        referenceVisible = transformGlm(objects, planes, referenceModels.data(), referenceMask.data());
+    });
+    LOG("%u objects, %u visible, %u iterations\n", count, referenceVisible, iterations);
+    LOG("\t%-8s %9.3f ms/batch %8.2f ns/object\n", "glm", referenceTime, referenceTime * 1e6 / count);
+
+    TransformBatchInput input{objects.x.data(), objects.y.data(), objects.z.data(), objects.angle.data(), objects.scale.data(), objects.radius.data(), count};
+    TransformBatchOutput output{models.data(), sizeof(glm::mat4), mask.data()};
+    bool passed = true;
+    for (TransformKernel kernel : {TransformKernel::Scalar, TransformKernel::SSE, TransformKernel::AVX2}) {
+        if (!isTransformKernelSupported(kernel)) {
+            LOG("\t%-8s not supported on this CPU\n", transformKernelName(kernel));
+            continue;
+        }
+        uint32_t visible = 0;
+        double time = measure(iterations, [&] {
+            visible = transformBatch(kernel, input, planes, output);
+        });
+
+        // The polynomial sin/cos of the SIMD kernels is within a few ulp of libm
+        float maxError = 0.0f;
+        bool sameVisibleSet = visible == referenceVisible && mask == referenceMask;
+        if (sameVisibleSet) {
+            const float* expected = reinterpret_cast<const float*>(referenceModels.data());
+            const float* actual = reinterpret_cast<const float*>(models.data());
+            for (size_t i = 0; i < visible * 16; i++) {
+                maxError = std::max(maxError, std::abs(expected[i] - actual[i]));
+            }
+        }
+        bool match = sameVisibleSet && maxError < 1e-5f;
+        passed = passed && match;
+        LOG("\t%-8s %9.3f ms/batch %8.2f ns/object %6.2fx  %s (max error %.2g)\n", transformKernelName(kernel), time, time * 1e6 / count,
+            referenceTime / time, match ? "match" : "MISMATCH", maxError);
+    }
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/********************************************************************************************************************************/
@@ -0,0 +1,233 @@
+#if !defined(VERTEX_LAYOUT)
+#define VERTEX_LAYOUT
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "main.hpp"
+#include "mesh.hpp"
+
+/********************************************************************************************************************************/
+// Vertex buffer layouts. A layout is a list of attribute encodings; the vertex struct, its stride and the pipeline's
+// attribute descriptions are all derived from it at compile time, so the CPU packing and what the GPU reads cannot drift
+// apart. Normalized and half formats are converted by the vertex fetch hardware, so the shaders see floats in every layout.
+//
+//     float:   R32G32B32 position, R32G32B32 color, R32G32 uv       32 bytes per vertex
+//     half:    R16G16B16A16 float position, R8G8B8A8 unorm color,   16 bytes
+//              R16G16 unorm uv
+//     snorm16: R16G16B16A16 snorm position, otherwise like half     16 bytes
+//
+// Quantized positions rely on meshes being normalized to [-0.5, 0.5] (see normalizeMesh()); texture coordinates have to lie
+// in [0, 1] for UNORM16, so repeating ones make loadMesh() fall back to the float layout.
+enum class VertexFormat {
+    Float,
+    Half,
+    Snorm16,
+};
+
+inline const char* vertexFormatName(VertexFormat format) {
+    switch (format) {
+    case VertexFormat::Half:
+        return "half";
+    case VertexFormat::Snorm16:
+        return "snorm16";
+    default:
+        return "float";
+    }
+}
+
+// Locations 0 (position), 1 (color) and 2 (texture position) of binding 0
+const uint32_t VERTEX_ATTRIBUTE_COUNT = 3;
+
+namespace vertex_layout {
+
+enum class Encoding {
+    Float32,
+    Float16,
+    Snorm16,
+    Unorm16,
+    Unorm8,
+};
+
+constexpr VkFormat vkFormat(Encoding encoding, uint32_t components) {
+    switch (encoding) {
+    case Encoding::Float32:
+        return components == 2 ? VK_FORMAT_R32G32_SFLOAT : components == 3 ? VK_FORMAT_R32G32B32_SFLOAT
+            : components == 4 ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_UNDEFINED;
+    case Encoding::Float16:
+        return components == 2 ? VK_FORMAT_R16G16_SFLOAT : components == 4 ? VK_FORMAT_R16G16B16A16_SFLOAT : VK_FORMAT_UNDEFINED;
+    case Encoding::Snorm16:
+        return components == 2 ? VK_FORMAT_R16G16_SNORM : components == 4 ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_UNDEFINED;
+    case Encoding::Unorm16:
+        return components == 2 ? VK_FORMAT_R16G16_UNORM : components == 4 ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_UNDEFINED;
+    case Encoding::Unorm8:
+        return components == 4 ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_UNDEFINED;
+    default:
+        return VK_FORMAT_UNDEFINED;
+    }
+}
+
+// Round to nearest even; overflow saturates to infinity, values below the half range flush to zero
+inline uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) {
+        return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+    }
+    int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+    if (halfExponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (halfExponent <= 0) {
+        if (halfExponent < -10) {
+            return sign;
+        }
+        // Subnormal half: shift the mantissa (with its implicit bit) into place
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1) != 0)) {
+            half++;
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint32_t half = (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1) != 0)) {
+        // Carries into the exponent (and up to infinity) correctly
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+template <Encoding E> struct Component;
+
+template <> struct Component<Encoding::Float32> {
+    using Type = float;
+    static Type encode(float value) { return value; }
+};
+
+template <> struct Component<Encoding::Float16> {
+    using Type = uint16_t;
+    static Type encode(float value) { return floatToHalf(value); }
+};
+
+template <> struct Component<Encoding::Snorm16> {
+    using Type = int16_t;
+    static Type encode(float value) { return static_cast<Type>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f)); }
+};
+
+template <> struct Component<Encoding::Unorm16> {
+    using Type = uint16_t;
+    static Type encode(float value) { return static_cast<Type>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f)); }
+};
+
+template <> struct Component<Encoding::Unorm8> {
+    using Type = uint8_t;
+    static Type encode(float value) { return static_cast<Type>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f)); }
+};
+
+// N components of one encoding. Three component 16 and 8 bit formats are poorly supported as vertex formats, so those are
+// padded to four: the padding is 1 in the fourth component (w of a position, alpha of a color) and 0 otherwise.
+template <Encoding E, uint32_t N>
+struct Attribute {
+    static constexpr VkFormat FORMAT = vkFormat(E, N);
+    static_assert(FORMAT != VK_FORMAT_UNDEFINED, "no vertex format for this encoding and component count");
+
+    typename Component<E>::Type components[N];
+
+    void encode(const float* values, uint32_t count) {
+        for (uint32_t i = 0; i < N; i++) {
+            components[i] = Component<E>::encode(i < count ? values[i] : i == 3 ? 1.0f : 0.0f);
+        }
+    }
+};
+
+template <typename PositionAttribute, typename ColorAttribute, typename UvAttribute>
+struct VertexLayout {
+    struct Vertex {
+        PositionAttribute position;
+        ColorAttribute color;
+        UvAttribute uv;
+    };
+
+    static constexpr uint32_t STRIDE = sizeof(Vertex);
+    static constexpr std::array<VkVertexInputAttributeDescription, VERTEX_ATTRIBUTE_COUNT> ATTRIBUTES = {{
+        {0, 0, PositionAttribute::FORMAT, static_cast<uint32_t>(offsetof(Vertex, position))},
+        {1, 0, ColorAttribute::FORMAT, static_cast<uint32_t>(offsetof(Vertex, color))},
+        {2, 0, UvAttribute::FORMAT, static_cast<uint32_t>(offsetof(Vertex, uv))},
+    }};
+    // Attributes and strides 4-byte aligned are fast (and on some implementations required) for vertex fetch
+    static_assert(offsetof(Vertex, color) % 4 == 0 && offsetof(Vertex, uv) % 4 == 0 && STRIDE % 4 == 0, "misaligned vertex layout");
+
+    static std::vector<uint8_t> pack(const std::vector<MeshVertex>& vertices) {
+        std::vector<uint8_t> data(vertices.size() * STRIDE);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            Vertex vertex;
+            vertex.position.encode(&vertices[i].position.x, 3);
+            vertex.color.encode(&vertices[i].color.x, 3);
+            vertex.uv.encode(&vertices[i].uv.x, 2);
+            memcpy(data.data() + i * STRIDE, &vertex, STRIDE);
+        }
+        return data;
+    }
+};
+
+} // namespace vertex_layout
+
+using FloatVertexLayout = vertex_layout::VertexLayout<vertex_layout::Attribute<vertex_layout::Encoding::Float32, 3>,
+    vertex_layout::Attribute<vertex_layout::Encoding::Float32, 3>, vertex_layout::Attribute<vertex_layout::Encoding::Float32, 2>>;
+using HalfVertexLayout = vertex_layout::VertexLayout<vertex_layout::Attribute<vertex_layout::Encoding::Float16, 4>,
+    vertex_layout::Attribute<vertex_layout::Encoding::Unorm8, 4>, vertex_layout::Attribute<vertex_layout::Encoding::Unorm16, 2>>;
+using Snorm16VertexLayout = vertex_layout::VertexLayout<vertex_layout::Attribute<vertex_layout::Encoding::Snorm16, 4>,
+    vertex_layout::Attribute<vertex_layout::Encoding::Unorm8, 4>, vertex_layout::Attribute<vertex_layout::Encoding::Unorm16, 2>>;
+
+static_assert(FloatVertexLayout::STRIDE == 32 && HalfVertexLayout::STRIDE == 16 && Snorm16VertexLayout::STRIDE == 16, "unexpected vertex sizes");
+
+// Calls function(Layout{}) with the layout of `format`, turning the runtime choice into a compile-time one
+template <typename Function>
+void withVertexLayout(VertexFormat format, Function&& function) {
+    switch (format) {
+    case VertexFormat::Half:
+        function(HalfVertexLayout{});
+        break;
+    case VertexFormat::Snorm16:
+        function(Snorm16VertexLayout{});
+        break;
+    default:
+        function(FloatVertexLayout{});
+        break;
+    }
+}
+
+// True if the mesh survives the quantized layouts: positions within [-1, 1], colors and texture coordinates within [0, 1]
+inline bool isMeshQuantizable(const Mesh& mesh) {
+    for (const auto& vertex : mesh.vertices) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (std::abs(vertex.position[axis]) > 1.0f || vertex.color[axis] < 0.0f || vertex.color[axis] > 1.0f) {
+                return false;
+            }
+        }
+        for (int axis = 0; axis < 2; axis++) {
+            if (vertex.uv[axis] < 0.0f || vertex.uv[axis] > 1.0f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+/********************************************************************************************************************************/
+
+#endif